@@ -0,0 +1,87 @@
+#include <random>
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+
+#include "../include/Bitmap.hpp"
+#include "../include/DataStore.hpp"
+
+namespace
+{
+    constexpr size_t kBitmapBytes = 8 << 20;
+
+    std::vector<uint8_t> random_bitmap(uint32_t seed)
+    {
+        std::mt19937_64 rng(seed);
+        std::vector<uint8_t> bytes(kBitmapBytes);
+        for (size_t i = 0; i < bytes.size(); i += 8)
+        {
+            uint64_t word = rng();
+            for (size_t j = 0; j < 8; j++)
+            {
+                bytes[i + j] = static_cast<uint8_t>(word >> (j * 8));
+            }
+        }
+        return bytes;
+    }
+}
+
+static void BM_BitCount(benchmark::State &state)
+{
+    auto bytes = random_bitmap(1);
+    auto kernel = state.range(0) ? bitmap::count_avx2 : bitmap::count_scalar;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(kernel(bytes.data(), bytes.size()));
+    }
+    state.SetBytesProcessed(state.iterations() * bytes.size());
+}
+BENCHMARK(BM_BitCount)->ArgName("avx2")->Arg(0)->Arg(1);
+
+static void BM_BitCombine(benchmark::State &state)
+{
+    auto target = random_bitmap(1);
+    auto source = random_bitmap(2);
+    auto kernel = state.range(0) ? bitmap::combine_avx2 : bitmap::combine_scalar;
+    for (auto _ : state)
+    {
+        kernel(bitmap::Op::Xor, target.data(), source.data(), target.size());
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * target.size());
+}
+BENCHMARK(BM_BitCombine)->ArgName("avx2")->Arg(0)->Arg(1);
+
+// BITPOS for a clear bit in an all-ones bitmap: the scan reads every byte.
+static void BM_BitFind(benchmark::State &state)
+{
+    std::vector<uint8_t> bytes(kBitmapBytes, 0xff);
+    auto kernel = state.range(0) ? bitmap::find_avx2 : bitmap::find_scalar;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(kernel(bytes.data(), bytes.size(), false));
+    }
+    state.SetBytesProcessed(state.iterations() * bytes.size());
+}
+BENCHMARK(BM_BitFind)->ArgName("avx2")->Arg(0)->Arg(1);
+
+// BITOP AND over range(0) daily activity bitmaps, through the store.
+static void BM_BitOpAnd(benchmark::State &state)
+{
+    DataStore data_store;
+    std::vector<std::string> days;
+    for (int i = 0; i < state.range(0); i++)
+    {
+        auto bytes = random_bitmap(static_cast<uint32_t>(i));
+        days.push_back("active:" + std::to_string(i));
+        data_store.set(days.back(), std::string(bytes.begin(), bytes.end()));
+    }
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(data_store.bitop(DataStore::BitOp::And, "result", days));
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0) * kBitmapBytes);
+}
+BENCHMARK(BM_BitOpAnd)->Arg(2)->Arg(7)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
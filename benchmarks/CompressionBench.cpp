@@ -0,0 +1,69 @@
+#include <string>
+#include <benchmark/benchmark.h>
+
+#include "../include/Compression.hpp"
+#include "../include/DataStore.hpp"
+
+namespace
+{
+    // Repetitive JSON like the documents clients store with SET.
+    std::string json_document(size_t bytes)
+    {
+        std::string out = "[";
+        for (int i = 0; out.size() < bytes; i++)
+        {
+            out += R"({"id":)" + std::to_string(i) + R"(,"email":"user)" + std::to_string(i * 7919 % 100000) +
+                   R"(@example.com","plan":")" + (i % 3 ? "free" : "pro") +
+                   R"(","features":{"beta":true,"dark_mode":false},"visits":)" + std::to_string(i * 31 % 977) + "},";
+        }
+        out.resize(bytes);
+        return out;
+    }
+}
+
+static void BM_LzCompress(benchmark::State &state)
+{
+    std::string input = json_document(static_cast<size_t>(state.range(0)));
+    size_t compressed = 0;
+    for (auto _ : state)
+    {
+        std::string data = compression::lz_compress(input);
+        compressed = data.size();
+        benchmark::DoNotOptimize(data);
+    }
+    state.SetBytesProcessed(state.iterations() * input.size());
+    state.counters["ratio"] = static_cast<double>(input.size()) / static_cast<double>(compressed);
+}
+BENCHMARK(BM_LzCompress)->Arg(4 << 10)->Arg(64 << 10);
+
+static void BM_LzDecompress(benchmark::State &state)
+{
+    std::string input = json_document(static_cast<size_t>(state.range(0)));
+    std::string data = compression::lz_compress(input);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(compression::lz_decompress(data, input.size()));
+    }
+    state.SetBytesProcessed(state.iterations() * input.size());
+}
+BENCHMARK(BM_LzDecompress)->Arg(4 << 10)->Arg(64 << 10);
+
+// GET of a 16 KB document stored plain (0) or compressed (1).
+static void BM_GetLargeValue(benchmark::State &state)
+{
+    DataStore data_store;
+    if (state.range(0))
+    {
+        data_store.set_compression_threshold(1024);
+    }
+    std::string document = json_document(16 << 10);
+    data_store.set("doc", document);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(data_store.get("doc"));
+    }
+    state.SetBytesProcessed(state.iterations() * document.size());
+}
+BENCHMARK(BM_GetLargeValue)->ArgName("compressed")->Arg(0)->Arg(1);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,266 @@
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+
+#include "../include/DataStore.hpp"
+#include "../include/KeyStats.hpp"
+
+namespace
+{
+    constexpr int kKeyCount = 1024;
+
+    // Shared by every thread of a multi-threaded run so that contention on the
+    // store mutex shows up in the numbers.
+    DataStore g_store;
+
+    std::vector<std::string> make_keys(const std::string &prefix, int count)
+    {
+        std::vector<std::string> keys;
+        keys.reserve(count);
+        for (int i = 0; i < count; i++)
+        {
+            keys.push_back(prefix + std::to_string(i));
+        }
+        return keys;
+    }
+
+    std::string thread_prefix(const benchmark::State &state, const char *name)
+    {
+        return std::string(name) + ":" + std::to_string(state.thread_index()) + ":";
+    }
+}
+
+static void BM_Set(benchmark::State &state)
+{
+    auto keys = make_keys(thread_prefix(state, "set"), kKeyCount);
+    std::string value(state.range(0), 'x');
+    size_t i = 0;
+    for (auto _ : state)
+    {
+        g_store.set(keys[i++ % keys.size()], value);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Set)->Arg(16)->Arg(1024)->ThreadRange(1, 8)->UseRealTime();
+
+static void BM_Get(benchmark::State &state)
+{
+    auto keys = make_keys(thread_prefix(state, "get"), kKeyCount);
+    std::string value(state.range(0), 'x');
+    for (const auto &key : keys)
+    {
+        g_store.set(key, value);
+    }
+    size_t i = 0;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(g_store.get(keys[i++ % keys.size()]));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Get)->Arg(16)->Arg(1024)->ThreadRange(1, 8)->UseRealTime();
+
+// Thread 0 overwrites the keys the others read; reads do not wait for it.
+static void BM_GetDuringSets(benchmark::State &state)
+{
+    auto keys = make_keys("mixed:", kKeyCount);
+    std::string value(state.range(0), 'x');
+    if (state.thread_index() == 0)
+    {
+        for (const auto &key : keys)
+        {
+            g_store.set(key, value);
+        }
+    }
+    size_t i = state.thread_index();
+    for (auto _ : state)
+    {
+        const auto &key = keys[i++ % keys.size()];
+        if (state.thread_index() == 0)
+        {
+            g_store.set(key, value);
+        }
+        else
+        {
+            benchmark::DoNotOptimize(g_store.get(key));
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GetDuringSets)->Arg(16)->Arg(1024)->ThreadRange(2, 8)->UseRealTime();
+
+static void BM_Incr(benchmark::State &state)
+{
+    auto keys = make_keys(thread_prefix(state, "incr"), kKeyCount);
+    size_t i = 0;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(g_store.incr(keys[i++ % keys.size()]));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Incr)->ThreadRange(1, 8)->UseRealTime();
+
+static void BM_Lpush(benchmark::State &state)
+{
+    auto keys = make_keys(thread_prefix(state, "lpush"), kKeyCount);
+    std::string value(16, 'x');
+    size_t i = 0;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(g_store.lpush(keys[i++ % keys.size()], value));
+    }
+    state.SetItemsProcessed(state.iterations());
+
+    for (const auto &key : keys)
+    {
+        g_store.del(key);
+    }
+}
+BENCHMARK(BM_Lpush)->ThreadRange(1, 8)->UseRealTime();
+
+static void BM_Lrange(benchmark::State &state)
+{
+    std::string key = thread_prefix(state, "lrange") + std::to_string(state.range(0));
+    g_store.del(key);
+    for (int i = 0; i < state.range(0); i++)
+    {
+        g_store.rpush(key, "element-" + std::to_string(i));
+    }
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(g_store.lrange(key, 0, -1));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Lrange)->Arg(10)->Arg(100)->Arg(1000)->ThreadRange(1, 8)->UseRealTime();
+
+static void fill_store(DataStore &store, int keys, int value_size)
+{
+    std::string value(value_size, 'v');
+    for (int i = 0; i < keys; i++)
+    {
+        store.set("key:" + std::to_string(i), value);
+    }
+}
+
+static long file_size(const std::string &filename)
+{
+    FILE *f = std::fopen(filename.c_str(), "rb");
+    if (!f)
+    {
+        return 0;
+    }
+    std::fseek(f, 0, SEEK_END);
+    long size = std::ftell(f);
+    std::fclose(f);
+    return size;
+}
+
+static void BM_Save(benchmark::State &state)
+{
+    const std::string filename = "bench_save.rdb";
+    DataStore store;
+    fill_store(store, static_cast<int>(state.range(0)), static_cast<int>(state.range(1)));
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(store.save(filename));
+    }
+    state.SetBytesProcessed(state.iterations() * file_size(filename));
+    std::remove(filename.c_str());
+}
+BENCHMARK(BM_Save)->Args({10000, 64})->Args({1000, 4096})->Unit(benchmark::kMillisecond);
+
+static void BM_Load(benchmark::State &state)
+{
+    const std::string filename = "bench_load.rdb";
+    {
+        DataStore store;
+        fill_store(store, static_cast<int>(state.range(0)), static_cast<int>(state.range(1)));
+        store.save(filename);
+    }
+    DataStore store;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(store.load(filename));
+    }
+    state.SetBytesProcessed(state.iterations() * file_size(filename));
+    std::remove(filename.c_str());
+}
+BENCHMARK(BM_Load)->Args({10000, 64})->Args({1000, 4096})->Unit(benchmark::kMillisecond);
+
+// Time spent inside the store (i.e. holding its lock) to delete a list of
+// range(0) elements, synchronously with DEL or handed off with UNLINK.
+static void BM_DeleteList(benchmark::State &state)
+{
+    DataStore store;
+    store.set_lazyfree_threshold(SIZE_MAX);
+    bool async = state.range(1) != 0;
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        for (int i = 0; i < state.range(0); i++)
+        {
+            store.rpush("list", "element");
+        }
+        state.ResumeTiming();
+
+        benchmark::DoNotOptimize(async ? store.unlink("list") : store.del("list"));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_DeleteList)
+    ->ArgNames({"elements", "unlink"})
+    ->Args({1000, 0})
+    ->Args({1000, 1})
+    ->Args({1000000, 0})
+    ->Args({1000000, 1})
+    ->Iterations(10) // refilling the list dominates wall time otherwise
+    ->Unit(benchmark::kMicrosecond);
+
+// Per-access cost of the always-on hot key statistics.
+static void BM_RecordAccess(benchmark::State &state)
+{
+    static KeyStats stats;
+    auto keys = make_keys(thread_prefix(state, "stats"), kKeyCount);
+    size_t i = 0;
+    for (auto _ : state)
+    {
+        stats.record_access(keys[i++ % keys.size()]);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RecordAccess)->ThreadRange(1, 8)->UseRealTime();
+
+// Cost of tiering: spilling every value of range(0) bytes to the value log
+// and faulting each back in on GET.
+static void BM_TieredRoundTrip(benchmark::State &state)
+{
+    DataStore store;
+    DataStore::TieringOptions options;
+    options.directory = (std::filesystem::temp_directory_path() / "redis-lite-bench").string();
+    options.cold_after = std::chrono::seconds(0);
+    options.min_value_bytes = 1;
+    options.scan_budget = kKeyCount * 4;
+    store.enable_tiering(options);
+
+    auto keys = make_keys("tiered:", kKeyCount);
+    std::string value(state.range(0), 'x');
+    for (const auto &key : keys)
+    {
+        store.set(key, value);
+    }
+    for (auto _ : state)
+    {
+        store.run_tiering();
+        for (const auto &key : keys)
+        {
+            benchmark::DoNotOptimize(store.get(key));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * keys.size());
+    state.SetBytesProcessed(state.iterations() * keys.size() * value.size());
+}
+BENCHMARK(BM_TieredRoundTrip)->Arg(256)->Arg(4096)->Unit(benchmark::kMicrosecond);
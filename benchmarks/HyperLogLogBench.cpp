@@ -0,0 +1,65 @@
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+
+#include "../include/HyperLogLog.hpp"
+
+namespace
+{
+    HyperLogLog make_hll(int elements, const std::string &prefix)
+    {
+        HyperLogLog hll;
+        for (int i = 0; i < elements; i++)
+        {
+            hll.add(prefix + std::to_string(i));
+        }
+        return hll;
+    }
+}
+
+// range(0) elements already in the counter: 100 stays sparse, 100000 is dense.
+static void BM_PfAdd(benchmark::State &state)
+{
+    HyperLogLog hll = make_hll(static_cast<int>(state.range(0)), "base:");
+    std::vector<std::string> elements;
+    for (int i = 0; i < 1024; i++)
+    {
+        elements.push_back("new:" + std::to_string(i));
+    }
+    size_t i = 0;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(hll.add(elements[i++ % elements.size()]));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PfAdd)->Arg(100)->Arg(100000);
+
+static void BM_MaxRegisters(benchmark::State &state)
+{
+    std::vector<uint8_t> target(HyperLogLog::kRegisters, 3);
+    std::vector<uint8_t> source(HyperLogLog::kRegisters, 5);
+    auto kernel = state.range(0) ? HyperLogLog::max_registers_avx2 : HyperLogLog::max_registers_scalar;
+    for (auto _ : state)
+    {
+        kernel(target.data(), source.data(), target.size());
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * target.size());
+}
+BENCHMARK(BM_MaxRegisters)->ArgName("avx2")->Arg(0)->Arg(1);
+
+// PFCOUNT over two dense keys: merge into a scratch counter, then estimate.
+static void BM_PfCountUnion(benchmark::State &state)
+{
+    HyperLogLog a = make_hll(100000, "a:");
+    HyperLogLog b = make_hll(100000, "b:");
+    for (auto _ : state)
+    {
+        HyperLogLog merged;
+        merged.merge(a);
+        merged.merge(b);
+        benchmark::DoNotOptimize(merged.count());
+    }
+}
+BENCHMARK(BM_PfCountUnion)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,61 @@
+#include <memory>
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+
+#include "../include/PubSub.hpp"
+
+namespace
+{
+    // Holds on to the last delivered buffer, as a connection's send queue would.
+    class QueueingSubscriber : public Subscriber
+    {
+    public:
+        int protocol() const override { return 2; }
+        void deliver(std::shared_ptr<const std::string> message) override { m_last = std::move(message); }
+
+    private:
+        std::shared_ptr<const std::string> m_last;
+    };
+}
+
+static void BM_PublishFanOut(benchmark::State &state)
+{
+    PubSub pubsub;
+    std::vector<QueueingSubscriber> subscribers(state.range(0));
+    for (auto &subscriber : subscribers)
+    {
+        pubsub.subscribe(subscriber, "channel");
+    }
+
+    std::string payload(state.range(1), 'p');
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(pubsub.publish("channel", payload));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.counters["deliveries"] = static_cast<double>(state.range(0));
+}
+BENCHMARK(BM_PublishFanOut)
+    ->ArgNames({"subscribers", "payload"})
+    ->Args({1, 64})
+    ->Args({100, 64})
+    ->Args({10000, 64})
+    ->Args({10000, 65536});
+
+static void BM_PublishPatterns(benchmark::State &state)
+{
+    PubSub pubsub;
+    std::vector<QueueingSubscriber> subscribers(state.range(0));
+    for (size_t i = 0; i < subscribers.size(); i++)
+    {
+        pubsub.psubscribe(subscribers[i], "news." + std::to_string(i) + ".*");
+    }
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(pubsub.publish("news.7.tech", "payload"));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PublishPatterns)->Arg(10)->Arg(1000);
@@ -0,0 +1,144 @@
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+
+#include "../include/CpuFeatures.hpp"
+#include "../include/RESPParser.hpp"
+#include "../include/RESPScanner.hpp"
+
+namespace
+{
+    std::string encode_command(const std::vector<std::string> &args)
+    {
+        std::string out = "*" + std::to_string(args.size()) + "\r\n";
+        for (const auto &arg : args)
+        {
+            out += "$" + std::to_string(arg.size()) + "\r\n" + arg + "\r\n";
+        }
+        return out;
+    }
+
+    // A SET command whose value is `value_size` bytes, repeated `pipeline` times.
+    std::string make_input(size_t value_size, size_t pipeline)
+    {
+        std::string command = encode_command({"SET", "key:000123", std::string(value_size, 'v')});
+        std::string input;
+        input.reserve(command.size() * pipeline);
+        for (size_t i = 0; i < pipeline; i++)
+        {
+            input += command;
+        }
+        return input;
+    }
+}
+
+static void BM_ParseCommand(benchmark::State &state)
+{
+    std::string input = make_input(state.range(0), state.range(1));
+    for (auto _ : state)
+    {
+        RESPParser parser(input);
+        while (parser.has_next())
+        {
+            benchmark::DoNotOptimize(parser.next_command());
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * input.size());
+    state.SetItemsProcessed(state.iterations() * state.range(1));
+}
+BENCHMARK(BM_ParseCommand)
+    ->ArgNames({"value", "pipeline"})
+    ->Args({3, 1})
+    ->Args({3, 64})
+    ->Args({64, 1})
+    ->Args({64, 64})
+    ->Args({1024, 16})
+    ->Args({16384, 4});
+
+static void BM_ParsePing(benchmark::State &state)
+{
+    std::string input;
+    for (int i = 0; i < state.range(0); i++)
+    {
+        input += "*1\r\n$4\r\nPING\r\n";
+    }
+    for (auto _ : state)
+    {
+        RESPParser parser(input);
+        while (parser.has_next())
+        {
+            benchmark::DoNotOptimize(parser.next_command());
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * input.size());
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ParsePing)->Arg(1)->Arg(128);
+
+static void BM_ParseInline(benchmark::State &state)
+{
+    std::string input;
+    for (int i = 0; i < state.range(0); i++)
+    {
+        input += "SET key:000123 value\r\n";
+    }
+    for (auto _ : state)
+    {
+        RESPParser parser(input);
+        while (parser.has_next())
+        {
+            benchmark::DoNotOptimize(parser.next_command());
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * input.size());
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ParseInline)->Arg(1)->Arg(128);
+
+// Zero-copy parse into views, which is what the server's read loop uses.
+static void BM_ParseCommandViews(benchmark::State &state)
+{
+    std::string input = make_input(state.range(0), state.range(1));
+    std::vector<std::string_view> args;
+    for (auto _ : state)
+    {
+        RESPParser parser(input);
+        while (parser.try_next_command(args))
+        {
+            benchmark::DoNotOptimize(args.data());
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * input.size());
+    state.SetItemsProcessed(state.iterations() * state.range(1));
+}
+BENCHMARK(BM_ParseCommandViews)
+    ->ArgNames({"value", "pipeline"})
+    ->Args({3, 1})
+    ->Args({3, 64})
+    ->Args({64, 64})
+    ->Args({1024, 16})
+    ->Args({16384, 4});
+
+static void BM_FindCRLF(benchmark::State &state)
+{
+    using Kernel = void (*)(const char *, size_t, size_t, size_t, std::vector<size_t> &);
+    const Kernel kernels[] = {resp::find_crlf_scalar, resp::find_crlf_sse2, resp::find_crlf_avx2};
+    if ((state.range(0) == 1 && !cpu::has_sse2()) || (state.range(0) == 2 && !cpu::has_avx2()))
+    {
+        state.SkipWithError("kernel not supported on this CPU");
+        return;
+    }
+    Kernel kernel = kernels[state.range(0)];
+
+    std::string input = make_input(3, 1024);
+    std::vector<size_t> positions;
+    positions.reserve(input.size() / 4);
+    for (auto _ : state)
+    {
+        positions.clear();
+        kernel(input.data(), input.size(), 0, input.size(), positions);
+        benchmark::DoNotOptimize(positions.data());
+    }
+    state.SetBytesProcessed(state.iterations() * input.size());
+}
+BENCHMARK(BM_FindCRLF)->ArgName("kernel")->DenseRange(0, 2);
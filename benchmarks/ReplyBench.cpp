@@ -0,0 +1,128 @@
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+
+#include "../include/RESPString.hpp"
+#include "../include/RESPWriter.hpp"
+
+// String concatenation as process_command used to build replies, kept as a
+// baseline for the RESPWriter benchmarks below.
+
+static void BM_SimpleStringReply(benchmark::State &state)
+{
+    RESPString ok("OK");
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(ok.serialize());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SimpleStringReply);
+
+static void BM_BulkStringReply(benchmark::State &state)
+{
+    std::string value(state.range(0), 'v');
+    for (auto _ : state)
+    {
+        std::string response = "$" + std::to_string(value.size()) + "\r\n" + value + "\r\n";
+        benchmark::DoNotOptimize(response);
+    }
+    state.SetBytesProcessed(state.iterations() * value.size());
+}
+BENCHMARK(BM_BulkStringReply)->Arg(16)->Arg(1024)->Arg(65536);
+
+static void BM_IntegerReply(benchmark::State &state)
+{
+    int value = 0;
+    for (auto _ : state)
+    {
+        std::string response = ":" + std::to_string(value++) + "\r\n";
+        benchmark::DoNotOptimize(response);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_IntegerReply);
+
+static void BM_ArrayReply(benchmark::State &state)
+{
+    std::vector<std::string> values(state.range(0), std::string(16, 'v'));
+    for (auto _ : state)
+    {
+        std::string response = "*" + std::to_string(values.size()) + "\r\n";
+        for (const auto &value : values)
+        {
+            response += "$" + std::to_string(value.size()) + "\r\n" + value + "\r\n";
+        }
+        benchmark::DoNotOptimize(response);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ArrayReply)->Arg(10)->Arg(100);
+
+// The same replies appended by RESPWriter into a reused output buffer, as the
+// server does per connection.
+
+static void BM_WriterSimpleStringReply(benchmark::State &state)
+{
+    std::string out;
+    for (auto _ : state)
+    {
+        out.clear();
+        RESPWriter writer(out);
+        writer.ok();
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_WriterSimpleStringReply);
+
+static void BM_WriterBulkStringReply(benchmark::State &state)
+{
+    std::string value(state.range(0), 'v');
+    std::string out;
+    for (auto _ : state)
+    {
+        out.clear();
+        RESPWriter writer(out);
+        writer.bulk_string(value);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetBytesProcessed(state.iterations() * value.size());
+}
+BENCHMARK(BM_WriterBulkStringReply)->Arg(16)->Arg(1024)->Arg(65536);
+
+static void BM_WriterIntegerReply(benchmark::State &state)
+{
+    // Range 0 stays inside the shared small-integer table, range 1 does not.
+    int64_t base = state.range(0) == 0 ? 0 : 1000000;
+    int64_t i = 0;
+    std::string out;
+    for (auto _ : state)
+    {
+        out.clear();
+        RESPWriter writer(out);
+        writer.integer(base + i++ % 10000);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_WriterIntegerReply)->Arg(0)->Arg(1);
+
+static void BM_WriterArrayReply(benchmark::State &state)
+{
+    std::vector<std::string> values(state.range(0), std::string(16, 'v'));
+    std::string out;
+    for (auto _ : state)
+    {
+        out.clear();
+        RESPWriter writer(out);
+        writer.array_header(values.size());
+        for (const auto &value : values)
+        {
+            writer.bulk_string(value);
+        }
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_WriterArrayReply)->Arg(10)->Arg(100);
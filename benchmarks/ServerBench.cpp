@@ -0,0 +1,180 @@
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <benchmark/benchmark.h>
+
+#include "../include/Server.hpp"
+
+namespace
+{
+    // An in-process server on an ephemeral port, stopped on destruction.
+    class RunningServer
+    {
+    public:
+        explicit RunningServer(int io_threads)
+            : m_server(0, io_threads), m_thread([this]
+                                                { m_server.start(); })
+        {
+        }
+
+        ~RunningServer()
+        {
+            m_server.stop();
+            m_thread.join();
+        }
+
+        int port() const { return m_server.port(); }
+
+    private:
+        Server m_server;
+        std::thread m_thread;
+    };
+
+    int connect_to(int port)
+    {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (connect(fd, (sockaddr *)&addr, sizeof(addr)) < 0)
+        {
+            close(fd);
+            return -1;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        return fd;
+    }
+
+    struct Connection
+    {
+        int fd;
+        std::string request;
+        size_t sent;
+        size_t received;
+    };
+}
+
+// Every connection sends a pipeline of range(2) SET/GET pairs per iteration;
+// the iteration ends when all replies are in. range(0) is the number of I/O
+// threads, 0 meaning the single-threaded coroutine loop.
+static void BM_Pipeline(benchmark::State &state)
+{
+    const int io_threads = static_cast<int>(state.range(0));
+    const size_t connections = static_cast<size_t>(state.range(1));
+    const size_t pipeline = static_cast<size_t>(state.range(2));
+
+    RunningServer server(io_threads);
+    int epoll_fd = epoll_create1(0);
+    std::vector<Connection> conns;
+    conns.reserve(connections);
+
+    // GET replies "$5\r\nvalue\r\n" (11 bytes) and SET replies "+OK\r\n" (5 bytes).
+    const size_t reply_bytes = pipeline * (11 + 5);
+    for (size_t c = 0; c < connections; c++)
+    {
+        int fd = connect_to(server.port());
+        if (fd < 0)
+        {
+            state.SkipWithError("connect failed");
+            break;
+        }
+        std::string key = "bench:" + std::to_string(c);
+        std::string request;
+        for (size_t i = 0; i < pipeline; i++)
+        {
+            request += "*3\r\n$3\r\nSET\r\n$" + std::to_string(key.size()) + "\r\n" + key + "\r\n$5\r\nvalue\r\n";
+            request += "*2\r\n$3\r\nGET\r\n$" + std::to_string(key.size()) + "\r\n" + key + "\r\n";
+        }
+        conns.push_back({fd, std::move(request), 0, 0});
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.ptr = &conns.back();
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event);
+    }
+
+    std::vector<epoll_event> events(1024);
+    char buffer[64 * 1024];
+    for (auto _ : state)
+    {
+        for (auto &conn : conns)
+        {
+            conn.sent = 0;
+            conn.received = 0;
+            while (conn.sent < conn.request.size())
+            {
+                ssize_t n = send(conn.fd, conn.request.data() + conn.sent, conn.request.size() - conn.sent, MSG_NOSIGNAL);
+                if (n <= 0)
+                {
+                    break; // requests are small; the rest goes out below
+                }
+                conn.sent += n;
+            }
+        }
+
+        size_t pending = conns.size();
+        while (pending > 0)
+        {
+            int n = epoll_wait(epoll_fd, events.data(), static_cast<int>(events.size()), 1000);
+            if (n <= 0)
+            {
+                state.SkipWithError("timed out waiting for replies");
+                break;
+            }
+            for (int i = 0; i < n; i++)
+            {
+                auto *conn = static_cast<Connection *>(events[i].data.ptr);
+                ssize_t got;
+                while ((got = recv(conn->fd, buffer, sizeof(buffer), 0)) > 0)
+                {
+                    conn->received += got;
+                }
+                if (conn->received == reply_bytes)
+                {
+                    conn->received++; // count it once
+                    pending--;
+                }
+            }
+            for (auto &conn : conns)
+            {
+                if (conn.sent < conn.request.size())
+                {
+                    ssize_t sent = send(conn.fd, conn.request.data() + conn.sent, conn.request.size() - conn.sent, MSG_NOSIGNAL);
+                    conn.sent += sent > 0 ? sent : 0;
+                }
+            }
+        }
+        if (pending > 0)
+        {
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * connections * pipeline * 2);
+
+    for (auto &conn : conns)
+    {
+        close(conn.fd);
+    }
+    close(epoll_fd);
+}
+BENCHMARK(BM_Pipeline)
+    ->ArgNames({"io_threads", "conns", "pipeline"})
+    ->Args({0, 1000, 1})
+    ->Args({2, 1000, 1})
+    ->Args({4, 1000, 1})
+    ->Args({0, 1000, 16})
+    ->Args({2, 1000, 16})
+    ->Args({4, 1000, 16})
+    ->Args({0, 8000, 1}) // two fds per connection in this process: mind ulimit -n
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
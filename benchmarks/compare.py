@@ -0,0 +1,82 @@
+#!/usr/bin/env python3
+"""Compare two Google Benchmark JSON reports and flag hot-path regressions.
+
+Produce the reports with, for example:
+
+    ./DataStoreBench --benchmark_out=base.json --benchmark_out_format=json
+
+then run:
+
+    compare.py base.json contender.json [--threshold 0.05] [--filter REGEX]
+
+Exits with status 1 if any benchmark present in both reports got slower by
+more than the threshold (relative change in time per iteration).
+"""
+
+import argparse
+import json
+import re
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        report = json.load(f)
+
+    results = {}
+    for bench in report.get("benchmarks", []):
+        # With --benchmark_repetitions only the aggregate mean is comparable.
+        if bench.get("run_type") == "aggregate" and bench.get("aggregate_name") != "mean":
+            continue
+        name = bench.get("run_name", bench["name"])
+        results[name] = bench
+    return results
+
+
+def time_of(bench, field):
+    # Normalize to nanoseconds so reports with different --benchmark_time_unit compare.
+    scale = {"ns": 1.0, "us": 1e3, "ms": 1e6, "s": 1e9}[bench.get("time_unit", "ns")]
+    return bench[field] * scale
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("baseline")
+    parser.add_argument("contender")
+    parser.add_argument("--threshold", type=float, default=0.05,
+                        help="allowed relative slowdown before failing (default 0.05)")
+    parser.add_argument("--field", choices=["real_time", "cpu_time"], default="cpu_time")
+    parser.add_argument("--filter", default=None, help="only compare benchmarks matching REGEX")
+    args = parser.parse_args()
+
+    baseline = load(args.baseline)
+    contender = load(args.contender)
+    pattern = re.compile(args.filter) if args.filter else None
+
+    regressions = []
+    print(f"{'benchmark':<60} {'base':>12} {'new':>12} {'change':>8}")
+    for name, base in baseline.items():
+        if name not in contender or (pattern and not pattern.search(name)):
+            continue
+        old = time_of(base, args.field)
+        new = time_of(contender[name], args.field)
+        change = (new - old) / old if old > 0 else 0.0
+        flag = ""
+        if change > args.threshold:
+            regressions.append(name)
+            flag = "  REGRESSION"
+        print(f"{name:<60} {old:>10.1f}ns {new:>10.1f}ns {change:>+7.1%}{flag}")
+
+    missing = sorted(set(baseline) - set(contender))
+    for name in missing:
+        print(f"{name:<60} missing from contender")
+
+    if regressions:
+        print(f"\n{len(regressions)} benchmark(s) regressed by more than {args.threshold:.0%}")
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
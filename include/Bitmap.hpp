@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Kernels behind the bitmap commands, operating on raw string bytes. Bits
+// are numbered from the most significant bit of the first byte, as in Redis.
+namespace bitmap
+{
+    enum class Op
+    {
+        And,
+        Or,
+        Xor,
+    };
+
+    // Number of set bits in `size` bytes.
+    uint64_t count(const uint8_t *data, size_t size);
+    // Position of the first bit equal to `bit`, or -1.
+    int64_t find(const uint8_t *data, size_t size, bool bit);
+    // target[i] = target[i] op source[i]
+    void combine(Op op, uint8_t *target, const uint8_t *source, size_t size);
+    void invert(uint8_t *data, size_t size);
+
+    // The dispatching functions above pick the widest of these kernels the
+    // CPU supports; they are exposed for tests and benchmarks.
+    uint64_t count_scalar(const uint8_t *data, size_t size);
+    uint64_t count_avx2(const uint8_t *data, size_t size);
+    int64_t find_scalar(const uint8_t *data, size_t size, bool bit);
+    int64_t find_avx2(const uint8_t *data, size_t size, bool bit);
+    void combine_scalar(Op op, uint8_t *target, const uint8_t *source, size_t size);
+    void combine_avx2(Op op, uint8_t *target, const uint8_t *source, size_t size);
+    void invert_scalar(uint8_t *data, size_t size);
+    void invert_avx2(uint8_t *data, size_t size);
+}
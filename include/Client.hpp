@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "PubSub.hpp"
+
+// Per-connection state owned by the server. Other connections may push
+// messages to it (pub/sub, invalidations) through the Subscriber interface;
+// those are queued as shared buffers and written by the connection itself.
+class Client : public Subscriber
+{
+public:
+    // Pushed messages beyond this many unsent bytes disconnect the client.
+    static constexpr size_t kDefaultPushLimit = 32 * 1024 * 1024;
+
+    Client(uint64_t id, int socket, size_t push_limit = kDefaultPushLimit);
+    ~Client() override;
+
+    Client(const Client &) = delete;
+    Client &operator=(const Client &) = delete;
+
+    int protocol() const override { return m_protocol; }
+    void set_protocol(int protocol) { m_protocol = protocol; }
+    void deliver(std::shared_ptr<const std::string> message) override;
+
+    // Readable whenever messages have been pushed or the client was dropped.
+    // Created on first use, which must precede any delivery.
+    int wake_fd();
+    void clear_wake();
+    // Called instead of signalling the wake fd. Only for connections whose
+    // pushes all come from their own thread, e.g. the coroutine event loop.
+    void set_wake_handler(std::function<void()> handler) { m_wake_handler = std::move(handler); }
+    // Moves pushed messages to the connection's send queue and returns it.
+    // Their bytes stay charged against the push limit until release_pushed()
+    // is called once they have been written.
+    std::deque<std::shared_ptr<const std::string>> &take_pushed();
+    void release_pushed(size_t bytes);
+    // Set once the push limit was exceeded; the connection must be closed.
+    bool dropped() const { return m_dropped; }
+
+    const uint64_t id;
+    const int socket;
+    std::string query;     // received bytes not yet parsed into commands
+    std::string output;    // encoded replies not yet written to the socket
+    size_t push_offset{0}; // bytes of the first pushed message already written
+    bool tracking{false};  // CLIENT TRACKING in default mode: remember keys read
+
+    // Set by a blocking command (BLPOP) that found nothing to serve: the
+    // connection waits for one of the keys to change or the deadline to pass,
+    // then runs the command again.
+    struct Blocked
+    {
+        std::vector<std::string> keys;
+        std::optional<std::chrono::steady_clock::time_point> deadline;
+    };
+    std::optional<Blocked> blocked;
+
+    // Threaded I/O mode: commands parsed by an I/O thread, awaiting execution.
+    std::vector<std::vector<std::string>> commands;
+    std::string protocol_error; // reply with this, then close
+    bool closing{false};
+    bool write_queued{false};
+    bool write_blocked{false};
+
+private:
+    std::atomic<int> m_protocol{2}; // RESP version negotiated with HELLO
+    std::atomic<bool> m_dropped{false};
+    int m_wake_fd{-1};
+    std::function<void()> m_wake_handler;
+    size_t m_push_limit;
+
+    std::mutex m_push_mutex;
+    std::deque<std::shared_ptr<const std::string>> m_pushed;
+    size_t m_pushed_bytes{0};
+
+    // Only touched by the connection's own thread.
+    std::deque<std::shared_ptr<const std::string>> m_sending;
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <variant>
+
+// In-memory compression of large values.
+namespace compression
+{
+    enum class Codec : uint8_t
+    {
+        LZ = 1,
+    };
+
+    // A compressed value. The codec is recorded with every block so that
+    // stored blocks stay readable when codecs are added.
+    struct Block
+    {
+        Codec codec;
+        size_t size; // uncompressed
+        std::string data;
+    };
+
+    // A string held compressed only where that paid off, for values such as
+    // list elements that are compressed one by one.
+    using Packed = std::variant<std::string, Block>;
+
+    // Returns std::nullopt if the codec does not make the input smaller.
+    std::optional<Block> compress(std::string_view input, Codec codec = Codec::LZ);
+    // Throws std::runtime_error if the block is corrupt.
+    std::string decompress(const Block &block);
+    // Whether `block`, e.g. one read from a file, decompresses.
+    bool is_valid(const Block &block);
+
+    // LZ77 with a 64 KB window and greedy matching through a single-entry
+    // hash table, in the LZ4 block format. Exposed for tests and benchmarks.
+    std::string lz_compress(std::string_view input);
+    std::string lz_decompress(std::string_view data, size_t size);
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+// Runtime CPU feature detection used to pick SIMD kernels. The results are
+// computed once and cached, so these are cheap enough to call per dispatch.
+namespace cpu
+{
+    bool has_sse2();
+    bool has_avx2();
+}
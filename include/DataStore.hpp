@@ -1,6 +1,9 @@
 #pragma once
 
+#include <atomic>
 #include <chrono>
+#include <functional>
+#include <memory>
 #include <optional>
 #include <mutex>
 #include <unordered_map>
@@ -9,6 +12,16 @@
 #include <variant>
 #include <vector>
 
+#include "Compression.hpp"
+#include "HyperLogLog.hpp"
+#include "KeyStats.hpp"
+#include "LazyFree.hpp"
+#include "ReadIndex.hpp"
+#include "ValueLog.hpp"
+
+// Thread-safe unless set_single_threaded() says otherwise. Writers serialize
+// on the store lock; GET and EXISTS of plain strings take no lock at all and
+// read from a ReadIndex kept in step with every write.
 class DataStore
 {
 public:
@@ -17,26 +30,197 @@ public:
     std::string get(const std::string &key);
     bool exists(const std::string &key);
     bool del(const std::string &key);
+    // Like del(), but large values are always reclaimed in the background.
+    bool unlink(const std::string &key);
+    void flushall(bool async = false);
     int incr(const std::string &key);
     int decr(const std::string &key);
 
     int lpush(const std::string &key, const std::string &value);
     int rpush(const std::string &key, const std::string &value);
     std::vector<std::string> lrange(const std::string &key, int start, int stop);
+    // Remove and return the first/last element; an emptied list is deleted.
+    std::optional<std::string> lpop(const std::string &key);
+    std::optional<std::string> rpop(const std::string &key);
+
+    // HyperLogLog counters. These throw std::runtime_error with a WRONGTYPE
+    // message when a key holds another type.
+    // True if the key was created or its estimate may have changed.
+    bool pfadd(const std::string &key, const std::vector<std::string> &elements);
+    // Estimated cardinality of the union of the keys; missing keys are empty.
+    uint64_t pfcount(const std::vector<std::string> &keys);
+    // Stores the union of `dest` and `sources` in `dest`.
+    void pfmerge(const std::string &dest, const std::vector<std::string> &sources);
+
+    // Bitmaps, operating in place on string values. These throw
+    // std::runtime_error with a WRONGTYPE message when a key holds another
+    // type. Bit 0 is the most significant bit of the first byte.
+    static constexpr uint64_t kMaxBitOffset = (uint64_t{1} << 32) - 1; // 512 MB
+    // Returns the previous bit; the string is zero-extended to reach `offset`.
+    int setbit(const std::string &key, uint64_t offset, bool bit);
+    int getbit(const std::string &key, uint64_t offset);
+    // Inclusive range in bytes, or in bits if `bits` is set; negative values
+    // count from the end. A missing end means the end of the string.
+    struct BitRange
+    {
+        int64_t start{0};
+        std::optional<int64_t> end;
+        bool bits{false};
+    };
+    uint64_t bitcount(const std::string &key, const BitRange &range);
+    // Position of the first bit equal to `bit` in the range, or -1. As in
+    // Redis, a search for a clear bit with no end given finds the first bit
+    // past the string.
+    int64_t bitpos(const std::string &key, bool bit, const BitRange &range);
+    enum class BitOp
+    {
+        And,
+        Or,
+        Xor,
+        Not, // takes exactly one source
+    };
+    // Stores the result in `dest`, deleting it if the result is empty, and
+    // returns its length. Shorter sources are zero-extended.
+    size_t bitop(BitOp op, const std::string &dest, const std::vector<std::string> &sources);
 
     bool save(const std::string &filename);
     bool load(const std::string &filename);
 
+    // Invoked with the key after every write or expiry, while the store lock
+    // is held. The listener must not call back into the store.
+    using KeyListener = std::function<void(const std::string &key)>;
+    void set_key_listener(KeyListener listener);
+    // Invoked after flushall(), while the store lock is held.
+    void set_flush_listener(std::function<void()> listener);
+
+    // Values made of more than this many allocations (list elements) are
+    // handed to the background reclaimer when deleted or overwritten.
+    static constexpr size_t kDefaultLazyFreeThreshold = 4096;
+    void set_lazyfree_threshold(size_t threshold);
+    LazyFree::Stats lazyfree_stats() const;
+
+    // Strings and list elements of at least `threshold` bytes are kept
+    // compressed in memory and decompressed on each read. 0, the default,
+    // turns compression off.
+    void set_compression_threshold(size_t threshold);
+    struct CompressionStats
+    {
+        size_t threshold;
+        uint64_t compressed;     // values compressed, when stored or snapshotted
+        uint64_t incompressible; // values over the threshold that did not shrink
+        uint64_t input_bytes;    // of the compressed values, before and after
+        uint64_t output_bytes;
+        uint64_t decompressed;
+        std::chrono::nanoseconds compress_time;
+        std::chrono::nanoseconds decompress_time;
+    };
+    CompressionStats compression_stats();
+
+    // Skips the store lock entirely, and stops maintaining the lock-free
+    // read index. Only for a store that a single thread executes every
+    // command against; set before that thread starts.
+    void set_single_threaded(bool single_threaded);
+
+    // Tiered storage: values left unaccessed for `cold_after` move to an
+    // on-disk value log and are read back into memory on their next access,
+    // so memory use follows the working set. Only the key and a log location
+    // stay in memory for a spilled value.
+    struct TieringOptions
+    {
+        std::string directory;
+        std::chrono::seconds cold_after{300};
+        // Smaller values are not worth the disk read.
+        size_t min_value_bytes{256};
+        // Entries examined per run_tiering() call.
+        size_t scan_budget{4096};
+    };
+    struct TieringStats
+    {
+        size_t spilled_keys;
+        uint64_t spilled_bytes;
+        ValueLog::Stats log;
+    };
+    void enable_tiering(TieringOptions options);
+    // Spills values that went cold and installs the moves made by log
+    // compaction. Call periodically; each call does a bounded amount of work.
+    void run_tiering();
+    TieringStats tiering_stats();
+
+    // Most accessed keys (sampled, decaying) and largest values per type.
+    std::vector<KeyStats::HotKey> hot_keys(size_t count);
+    std::vector<KeyStats::BigKey> big_keys(size_t count);
+
 private:
     struct ValueEntry
     {
-        using ValueType = std::variant<std::string, std::list<std::string>>;
+        // A ValueLog::Location stands in for a value spilled to disk, a
+        // compression::Block for a string compressed in memory, and a
+        // PublishedString for a string owned by the read index. Large list
+        // elements are compressed individually.
+        using ValueType = std::variant<std::string, std::list<compression::Packed>, ValueLog::Location, HyperLogLog,
+                                       compression::Block, PublishedString>;
         ValueType value;
         std::optional<std::chrono::steady_clock::time_point> expiry;
+        uint32_t last_access{0}; // m_access_clock at the last access
     };
 
+    // Declared first so it outlives, and can reclaim, everything below.
+    LazyFree m_lazy_free;
+
     std::unordered_map<std::string, ValueEntry> m_store;
     std::mutex m_store_mutex;
+    bool m_single_threaded{false};
+    ReadIndex m_index; // empty while single-threaded
+
+    KeyListener m_key_listener;
+    std::function<void()> m_flush_listener;
+    size_t m_lazyfree_threshold{kDefaultLazyFreeThreshold};
+    KeyStats m_key_stats;
+
+    std::unique_ptr<ValueLog> m_value_log; // set when tiering is enabled
+    TieringOptions m_tiering;
+    // Seconds since m_tiering_epoch, refreshed by run_tiering(); reading a
+    // clock on every access would cost more than the access. Lock-free
+    // readers stamp it on the index node instead of the entry.
+    std::atomic<uint32_t> m_access_clock{0};
+    std::chrono::steady_clock::time_point m_tiering_epoch;
+    size_t m_tiering_cursor{0}; // next bucket to scan for cold values
+    size_t m_spilled_keys{0};
+    uint64_t m_spilled_bytes{0};
+
+    size_t m_compression_threshold{0};
+    CompressionStats m_compression_stats{};
 
+    std::unique_lock<std::mutex> lock_store();
     bool is_expired_entry(const ValueEntry &entry) const;
+    void notify_modified(const std::string &key);
+    // Releases a value detached from the keyspace, in the background if it
+    // takes more than `threshold` allocations to free.
+    void dispose(ValueEntry::ValueType value, size_t threshold);
+    bool remove(const std::string &key, size_t lazyfree_threshold);
+    std::optional<std::string> pop(const std::string &key, bool front);
+    void track_size(const std::string &key, const ValueEntry &entry);
+    // Marks the entry as accessed and reads a spilled value back into memory.
+    void touch(ValueEntry &entry);
+    // `value` in the form it is stored: compressed if it is large enough and
+    // compresses.
+    compression::Packed pack(const std::string &value);
+    ValueEntry::ValueType pack_string(const std::string &value);
+    std::string unpack(const compression::Packed &value);
+    std::string unpack_string(const compression::Block &block);
+    // Decompresses a compressed string in place, for commands that modify it.
+    void inflate(ValueEntry &entry);
+    // Brings the index node for `key` in line with its entry, or removes it.
+    // With `share`, a plain string value moves into the index first, so that
+    // lock-free readers can serve it.
+    void index_update(const std::string &key, bool share = false);
+    void publish(const std::string &key, ValueEntry &entry, bool share);
+    // The live HyperLogLog under `key`, or nullptr if there is none.
+    HyperLogLog *find_hyperloglog(const std::string &key);
+    // The live string under `key`, or nullptr if there is none; read_string()
+    // for reading it, decompressing a compressed value into `unpacked`
+    // without touching the stored one, find_string() for modifying it in
+    // place.
+    const std::string *read_string(const std::string &key, std::string &unpacked);
+    std::string *find_string(const std::string &key);
 };
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Epoch-based reclamation for lock-free readers. A reader holds a Guard while
+// it follows shared pointers; a writer that unlinks an object retires it
+// instead of deleting it, and the object is freed once every guard that was
+// active at the time has been released. Guards are cheap (one store to a
+// per-thread slot), and never block writers or each other.
+namespace epoch
+{
+    class Guard
+    {
+    public:
+        Guard();
+        ~Guard();
+
+        Guard(const Guard &) = delete;
+        Guard &operator=(const Guard &) = delete;
+
+    private:
+        struct Participant *m_participant;
+    };
+
+    // Frees `object` with `deleter` once no guard can still reach it. The
+    // object must already be unreachable for guards created from now on.
+    // Occasionally collects on the calling thread.
+    void retire(void *object, void (*deleter)(void *));
+
+    template <typename T>
+    void retire(T *object)
+    {
+        retire(object, [](void *p)
+               { delete static_cast<T *>(p); });
+    }
+
+    // Advances the epoch if every active guard has caught up with it and
+    // frees what has become unreachable.
+    void collect();
+    // Retired objects not freed yet.
+    size_t pending();
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+// Recycles coroutine frames. Connection coroutines are created and destroyed
+// at the rate clients come and go, and their frames are a handful of sizes,
+// so freed frames are kept on per-size free lists of the allocating thread.
+class FramePool
+{
+public:
+    static void *allocate(size_t size);
+    static void deallocate(void *frame, size_t size);
+
+    // Frames currently parked on this thread's free lists.
+    static size_t cached_frames();
+};
+
+// A detached coroutine: it starts running when called and its frame is freed
+// when it returns. Whoever resumes it (the event loop) never holds on to it.
+struct Task
+{
+    struct promise_type
+    {
+        Task get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        // Nobody awaits a detached coroutine, so an exception escaping it is
+        // reported and ends that coroutine only.
+        void unhandled_exception();
+
+        static void *operator new(size_t size) { return FramePool::allocate(size); }
+        static void operator delete(void *frame, size_t size) { FramePool::deallocate(frame, size); }
+    };
+};
+
+// Single-threaded epoll loop that resumes coroutines suspended on socket
+// readiness or timers. Sockets are watched edge-triggered, so a coroutine
+// must only await readiness after the socket returned EAGAIN.
+class EventLoop
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    using Timers = std::multimap<Clock::time_point, std::function<void()>>;
+    using TimerId = Timers::iterator;
+
+    EventLoop();
+    ~EventLoop();
+
+    EventLoop(const EventLoop &) = delete;
+    EventLoop &operator=(const EventLoop &) = delete;
+
+    void watch(int fd);
+    void unwatch(int fd);
+
+    class IoWait
+    {
+    public:
+        IoWait(EventLoop &loop, int fd, uint32_t events) : m_loop(loop), m_fd(fd), m_events(events) {}
+        bool await_ready();
+        void await_suspend(std::coroutine_handle<> handle);
+        void await_resume() {}
+
+    private:
+        EventLoop &m_loop;
+        int m_fd;
+        uint32_t m_events;
+    };
+
+    // co_await these to suspend until a watched fd is ready. A resume may be
+    // spurious (see wake()); retry the operation and wait again.
+    IoWait readable(int fd) { return IoWait(*this, fd, kReadable); }
+    IoWait writable(int fd) { return IoWait(*this, fd, kWritable); }
+    // Resumes the coroutine waiting on `fd`, if any, as if it became ready.
+    void wake(int fd);
+    // Calls `callback` once, from the loop, when `fd` becomes readable or
+    // hangs up; for a coroutine parked on something else that still has to
+    // notice its peer going away. Not combined with readable() on the same fd.
+    void on_readable(int fd, std::function<void()> callback);
+    void cancel_on_readable(int fd);
+    // The same for writability, e.g. to flush output of a parked coroutine.
+    // Not combined with writable() on the same fd.
+    void on_writable(int fd, std::function<void()> callback);
+    void cancel_on_writable(int fd);
+
+    class Sleep
+    {
+    public:
+        Sleep(EventLoop &loop, Clock::duration duration) : m_loop(loop), m_duration(duration) {}
+        bool await_ready() { return false; }
+        void await_suspend(std::coroutine_handle<> handle);
+        void await_resume() {}
+
+    private:
+        EventLoop &m_loop;
+        Clock::duration m_duration;
+    };
+
+    Sleep sleep_for(Clock::duration duration) { return Sleep(*this, duration); }
+
+    // Resumes `handle` on the next iteration of the loop.
+    void post(std::coroutine_handle<> handle);
+
+    TimerId add_timer(Clock::time_point when, std::function<void()> callback);
+    // Only for timers that have not fired yet.
+    void cancel_timer(TimerId timer);
+
+    // Runs everything that is ready, waiting up to `max_wait` for something
+    // to become so.
+    void run_once(std::chrono::milliseconds max_wait);
+
+private:
+    static constexpr uint32_t kReadable = 1;
+    static constexpr uint32_t kWritable = 2;
+
+    struct Watch
+    {
+        std::coroutine_handle<> waiter;
+        uint32_t waiting_for{0};
+        uint32_t ready{0}; // edges seen while nobody was waiting
+        std::function<void()> on_readable;
+        std::function<void()> on_writable;
+    };
+
+    void ready(Watch &watch, uint32_t events);
+
+    int m_epoll_fd{-1};
+    std::unordered_map<int, Watch> m_watches;
+    std::deque<std::coroutine_handle<>> m_ready;
+    Timers m_timers;
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Cardinality estimator with 2^14 six-bit registers (0.81% standard error).
+// Counters start sparse, holding only the non-zero registers, and are
+// promoted to the packed dense form (12 KB) once that is smaller.
+class HyperLogLog
+{
+public:
+    static constexpr int kPrecision = 14;
+    static constexpr size_t kRegisters = size_t{1} << kPrecision;
+    static constexpr unsigned kRegisterBits = 6;
+    // One spare byte so that reading the last register never overruns.
+    static constexpr size_t kDenseBytes = kRegisters * kRegisterBits / 8 + 1;
+    static constexpr size_t kSparseMaxBytes = 3000;
+
+    // Returns true if a register changed, i.e. the estimate may have moved.
+    bool add(std::string_view element);
+    // Cached until the next change.
+    uint64_t count() const;
+    // Makes this the union of both counters.
+    void merge(const HyperLogLog &other);
+
+    bool is_sparse() const { return m_dense.empty(); }
+    size_t bytes() const;
+
+    std::string serialize() const;
+    // Throws std::runtime_error on malformed input.
+    static HyperLogLog deserialize(std::string_view data);
+
+    // Element-wise max over unpacked (one byte per register) arrays, exposed
+    // for tests and benchmarks. max_registers() picks the widest kernel.
+    static void max_registers(uint8_t *target, const uint8_t *source, size_t count);
+    static void max_registers_scalar(uint8_t *target, const uint8_t *source, size_t count);
+    static void max_registers_avx2(uint8_t *target, const uint8_t *source, size_t count);
+
+private:
+    // Sparse entries are (register index << 8 | value), sorted by index.
+    static uint32_t sparse_entry(uint32_t index, uint8_t value) { return index << 8 | value; }
+
+    void set_dense(size_t index, uint8_t value);
+    uint8_t get_dense(size_t index) const;
+    void promote();
+    void unpack(uint8_t *registers) const;
+    void pack(const uint8_t *registers);
+
+    std::vector<uint32_t> m_sparse;
+    std::vector<uint8_t> m_dense; // packed registers; empty while sparse
+    mutable std::optional<uint64_t> m_cached_count;
+};
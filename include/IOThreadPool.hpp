@@ -0,0 +1,46 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed pool used by the threaded I/O mode to fan a batch of per-client work
+// (reading and parsing, or writing replies) out across threads. run() splits
+// the batch between the workers and the calling thread and returns once all
+// of it is done, so phases never overlap.
+class IOThreadPool
+{
+public:
+    // `threads` counts the calling thread, so 1 means no workers at all.
+    explicit IOThreadPool(size_t threads);
+    ~IOThreadPool();
+
+    IOThreadPool(const IOThreadPool &) = delete;
+    IOThreadPool &operator=(const IOThreadPool &) = delete;
+
+    size_t size() const { return m_workers.size() + 1; }
+
+    // Calls task(i) for every i in [0, count).
+    void run(size_t count, const std::function<void(size_t)> &task);
+
+private:
+    void worker(size_t index);
+    void run_share(size_t index, size_t stride);
+
+    std::vector<std::thread> m_workers;
+
+    std::mutex m_mutex;
+    std::condition_variable m_start_cv;
+    std::condition_variable m_done_cv;
+    uint64_t m_generation{0};
+    size_t m_running{0};
+    bool m_stop{false};
+
+    // The batch being run; only valid while m_running > 0.
+    const std::function<void(size_t)> *m_task{nullptr};
+    size_t m_count{0};
+};
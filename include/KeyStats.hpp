@@ -0,0 +1,98 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Always-on key statistics. Accesses are sampled into a count-min sketch
+// with periodic halving, so hot keys surface from recent traffic; a small
+// candidate table keeps the keys with the highest estimates. Value sizes are
+// tracked per type in a bounded table of the largest values seen, so neither
+// report needs a keyspace scan.
+class KeyStats
+{
+public:
+    struct HotKey
+    {
+        std::string key;
+        uint64_t accesses; // estimated, scaled up by the sampling rate
+    };
+
+    struct BigKey
+    {
+        std::string key;
+        std::string type;
+        size_t size; // bytes for strings, elements for lists
+    };
+
+    // One access in 2^sample_shift is counted.
+    explicit KeyStats(unsigned sample_shift = 3, size_t top_k = 32);
+
+    // Thread safe; costs a thread-local increment unless sampled. Sampled
+    // keys are buffered in a per-thread shard and merged into the sketch in
+    // batches, so concurrent callers rarely share a lock or a cache line.
+    void record_access(const std::string &key);
+    // Merges the buffered samples first.
+    std::vector<HotKey> hot_keys(size_t count);
+
+    // Size tracking is not synchronized; callers serialize these (DataStore
+    // calls them under its store lock).
+    void record_size(const std::string &key, const char *type, size_t size);
+    void record_removal(const std::string &key);
+    void clear_sizes();
+    std::vector<BigKey> big_keys(size_t count) const;
+
+private:
+    static constexpr size_t kDepth = 4;
+    static constexpr size_t kWidth = 4096;
+    // Sampled accesses between halvings of every counter.
+    static constexpr uint64_t kDecayInterval = kWidth * 8;
+    static constexpr size_t kShards = 16;
+    // Sampled accesses a shard buffers before merging them.
+    static constexpr size_t kBatch = 64;
+
+    struct Sample
+    {
+        uint64_t hash;
+        std::string key;
+    };
+
+    struct alignas(64) Shard
+    {
+        std::mutex mutex;
+        std::vector<Sample> sampled;
+    };
+
+    struct SizeTable
+    {
+        std::unordered_map<std::string, size_t> sizes;
+        size_t min_size{0}; // smallest size held once the table is full
+    };
+
+    // Counts a batch of samples, which it sorts and empties.
+    void merge(std::vector<Sample> &sampled);
+    uint32_t increment_sketch(uint64_t hash, uint32_t count);
+    void update_min_size(SizeTable &table) const;
+    void decay();
+
+    const unsigned m_sample_shift;
+    const size_t m_top_k;
+
+    std::array<Shard, kShards> m_shards;
+    std::array<std::atomic<uint32_t>, kDepth * kWidth> m_sketch{};
+    std::atomic<uint64_t> m_samples{0};
+
+    mutable std::mutex m_hot_mutex;
+    std::unordered_map<std::string, uint32_t> m_hot; // up to 2 * top_k candidates
+    // Lower bound on the smallest candidate estimate; candidates only grow
+    // between decays, so it never rejects a key that would qualify.
+    uint32_t m_hot_floor{0};
+
+    std::map<std::string, SizeTable> m_big; // by type name
+    std::unordered_map<std::string, std::string> m_big_type; // key -> table it is in
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "PubSub.hpp"
+
+// Server side state for client-side caching (CLIENT TRACKING). In the default
+// mode it remembers which clients read which keys and sends each of them one
+// invalidation message on the next write to that key. In broadcast mode
+// clients instead get an invalidation for every write to a key matching one
+// of their prefixes, and nothing is remembered per key.
+//
+// RESP2 clients redirect invalidations to another connection, which only
+// receives them while subscribed to kInvalidateChannel. If that connection
+// goes away tracking is turned off, and a RESP3 client is told so with a
+// "tracking-redir-broken" push, as Redis does.
+class KeyTracker
+{
+public:
+    static constexpr size_t kDefaultMaxKeys = 1000000;
+
+    struct Options
+    {
+        bool broadcast{false};
+        std::vector<std::string> prefixes; // broadcast mode only; empty means every key
+    };
+
+    explicit KeyTracker(const PubSub &pubsub, size_t max_keys = kDefaultMaxKeys);
+
+    // Starts tracking for `client`; invalidations are sent to `target`, which
+    // is either the client itself (RESP3) or the connection it redirected to.
+    void enable(uint64_t client_id, Subscriber &client, Subscriber &target, const Options &options);
+    void disable(uint64_t client_id);
+    // Drops `client_id`'s tracking state and turns off tracking for the
+    // clients redirecting to it. Must be called before a client that may be
+    // a target is destroyed.
+    void forget(uint64_t client_id, const Subscriber &client);
+
+    // Records that `client_id` is about to read `key`. Call before the read
+    // so that a concurrent write always invalidates what was read.
+    void remember(uint64_t client_id, const std::string &key);
+    void invalidate(const std::string &key);
+    void invalidate_all();
+
+    size_t tracked_keys() const;
+
+    static constexpr const char *kInvalidateChannel = "__redis__:invalidate";
+
+private:
+    struct ClientState
+    {
+        Subscriber *client;
+        Subscriber *target;
+        Options options;
+    };
+
+    void disable_locked(uint64_t client_id);
+    void invalidate_locked(const std::string &key);
+    // Notifies the clients that read `key` and forgets it; prefix
+    // subscribers are left alone, as the key was not written.
+    void evict_locked(const std::string &key, std::shared_ptr<const std::string> encoded[2]);
+    void send(Subscriber &target, const std::string *key, std::shared_ptr<const std::string> encoded[2]);
+
+    const PubSub &m_pubsub;
+    size_t m_max_keys;
+    mutable std::mutex m_mutex;
+    std::unordered_map<uint64_t, ClientState> m_clients;
+    std::unordered_map<std::string, std::unordered_set<uint64_t>> m_keys;
+    // Broadcast prefix -> clients registered for it.
+    std::unordered_map<std::string, std::unordered_set<uint64_t>> m_prefixes;
+};
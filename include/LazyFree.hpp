@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
+// Destroys large objects on a background thread so that releasing them does
+// not stall callers holding a lock. Ownership moves in O(1); the worker
+// thread is started on first use.
+class LazyFree
+{
+public:
+    struct Stats
+    {
+        size_t pending_objects;
+        size_t pending_bytes; // estimated by the caller of free_later()
+        size_t freed_objects;
+    };
+
+    LazyFree() = default;
+    ~LazyFree();
+
+    LazyFree(const LazyFree &) = delete;
+    LazyFree &operator=(const LazyFree &) = delete;
+
+    template <typename T>
+    void free_later(T &&object, size_t bytes)
+    {
+        using Value = std::remove_cvref_t<T>;
+        enqueue(std::make_unique<Holder<Value>>(std::forward<T>(object)), bytes);
+    }
+
+    Stats stats() const;
+    // Blocks until everything queued so far has been freed.
+    void wait_idle();
+
+private:
+    struct Garbage
+    {
+        virtual ~Garbage() = default;
+    };
+
+    template <typename T>
+    struct Holder : Garbage
+    {
+        explicit Holder(T &&value) : value(std::move(value)) {}
+        explicit Holder(const T &value) : value(value) {}
+        T value;
+    };
+
+    struct Item
+    {
+        std::unique_ptr<Garbage> garbage;
+        size_t bytes;
+    };
+
+    void enqueue(std::unique_ptr<Garbage> garbage, size_t bytes);
+    void run();
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_work_cv;
+    std::condition_variable m_idle_cv;
+    std::deque<Item> m_queue;
+    bool m_busy{false};
+    bool m_stop{false};
+    std::thread m_thread;
+
+    std::atomic<size_t> m_pending_objects{0};
+    std::atomic<size_t> m_pending_bytes{0};
+    std::atomic<size_t> m_freed_objects{0};
+};
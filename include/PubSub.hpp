@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// A connection that can be handed messages produced by other connections.
+class Subscriber
+{
+public:
+    virtual ~Subscriber() = default;
+
+    virtual int protocol() const = 0;
+    // Queues an already encoded message. Must not block: a subscriber that
+    // cannot keep up is expected to drop itself rather than stall the caller.
+    virtual void deliver(std::shared_ptr<const std::string> message) = 0;
+};
+
+// Channel and pattern registry. A published payload is encoded once per
+// protocol version and the same reference counted buffer is handed to every
+// receiving subscriber. Subscribers are not owned and must call
+// unsubscribe_all() before they are destroyed.
+class PubSub
+{
+public:
+    // Each returns the subscriber's total number of channel and pattern
+    // subscriptions after the change, as SUBSCRIBE and friends reply with.
+    size_t subscribe(Subscriber &subscriber, const std::string &channel);
+    size_t unsubscribe(Subscriber &subscriber, const std::string &channel);
+    size_t psubscribe(Subscriber &subscriber, const std::string &pattern);
+    size_t punsubscribe(Subscriber &subscriber, const std::string &pattern);
+    void unsubscribe_all(Subscriber &subscriber);
+
+    std::vector<std::string> channels(const Subscriber &subscriber) const;
+    std::vector<std::string> patterns(const Subscriber &subscriber) const;
+    size_t subscription_count(const Subscriber &subscriber) const;
+    bool is_subscribed(const Subscriber &subscriber, const std::string &channel) const;
+
+    // Returns the number of subscribers the message was delivered to.
+    size_t publish(const std::string &channel, const std::string &message);
+
+    // Glob-style matching as used by PSUBSCRIBE: '*', '?', '[...]' and '\'.
+    static bool pattern_matches(std::string_view pattern, std::string_view text);
+
+private:
+    struct Subscriptions
+    {
+        std::unordered_set<std::string> channels;
+        std::unordered_set<std::string> patterns;
+    };
+
+    size_t count_locked(const Subscriber &subscriber) const;
+
+    // Publishers only take the lock shared, so they fan out concurrently.
+    mutable std::shared_mutex m_mutex;
+    std::unordered_map<std::string, std::unordered_set<Subscriber *>> m_channels;
+    std::unordered_map<std::string, std::unordered_set<Subscriber *>> m_patterns;
+    std::unordered_map<const Subscriber *, Subscriptions> m_subscriptions;
+};
@@ -1,18 +1,36 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 
 class RESPParser
 {
 public:
-    explicit RESPParser(const std::string &data);
+    // The parser reads `data` in place; the buffer must outlive the parser.
+    explicit RESPParser(std::string_view data);
 
     bool has_next();
     std::vector<std::string> next_command();
+    // Parses the next command into views over the input buffer. Returns false
+    // if the buffer ends mid-command; the partial command is left unconsumed.
+    // Throws std::runtime_error on malformed input.
+    bool try_next_command(std::vector<std::string_view> &args);
     std::string get_remaining_data() const;
+    size_t consumed() const;
 
 private:
-    std::string m_data;
+    bool parse_multibulk(std::vector<std::string_view> &args);
+    bool parse_inline(std::vector<std::string_view> &args);
+    size_t find_crlf(size_t from);
+
+    std::string_view m_data;
     size_t m_pos;
-};
\ No newline at end of file
+    bool m_incomplete;
+
+    // CRLF offsets found by the vectorized scanner, filled one block at a time
+    // so that bulk payloads skipped by their length prefix are never scanned.
+    std::vector<size_t> m_crlf;
+    size_t m_crlf_index;
+    size_t m_scanned;
+};
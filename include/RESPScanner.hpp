@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Low level helpers used by RESPParser to frame requests without allocating.
+namespace resp
+{
+    // Appends to `out` the offset of every "\r\n" in `data` whose '\r' lies in
+    // [from, to). `to` must not exceed `size`; the '\n' may sit at `to`.
+    // Dispatches at runtime to the widest kernel the CPU supports.
+    void find_crlf(const char *data, size_t size, size_t from, size_t to, std::vector<size_t> &out);
+
+    // Individual kernels, exposed for tests and benchmarks.
+    void find_crlf_scalar(const char *data, size_t size, size_t from, size_t to, std::vector<size_t> &out);
+    void find_crlf_sse2(const char *data, size_t size, size_t from, size_t to, std::vector<size_t> &out);
+    void find_crlf_avx2(const char *data, size_t size, size_t from, size_t to, std::vector<size_t> &out);
+
+    // Parses the unsigned decimal in [begin, end). Returns false if the range is
+    // empty, holds anything but digits, or the value exceeds `max_value`.
+    bool parse_length(const char *begin, const char *end, int64_t max_value, int64_t &value);
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Shared, preencoded replies that are appended verbatim.
+namespace shared_reply
+{
+    constexpr std::string_view ok = "+OK\r\n";
+    constexpr std::string_view pong = "+PONG\r\n";
+    constexpr std::string_view null_bulk = "$-1\r\n";
+    constexpr std::string_view null_array = "*-1\r\n";
+    constexpr std::string_view null_resp3 = "_\r\n";
+    constexpr std::string_view empty_array = "*0\r\n";
+}
+
+// Appends RESP encoded replies directly to a connection's output buffer.
+// Nothing is allocated besides the buffer's own amortized growth, so a
+// buffer that is cleared (not shrunk) between replies reaches a steady state
+// with no allocation at all. Types that only exist in RESP3 degrade to their
+// RESP2 equivalent when the connection speaks protocol 2.
+class RESPWriter
+{
+public:
+    explicit RESPWriter(std::string &buffer, int protocol = 2) : m_out(buffer), m_protocol(protocol) {}
+
+    int protocol() const { return m_protocol; }
+
+    void ok() { m_out.append(shared_reply::ok); }
+    void raw(std::string_view encoded) { m_out.append(encoded); }
+
+    void simple_string(std::string_view value);
+    // `message` includes the error code, e.g. "ERR syntax error".
+    void error(std::string_view message);
+    void integer(int64_t value);
+    void bulk_string(std::string_view value);
+    void null();
+    void null_array();
+    void array_header(size_t length);
+    // RESP3 map ("%"); in RESP2 a flat array of 2 * `pairs` elements.
+    void map_header(size_t pairs);
+    // RESP3 out-of-band push (">"); in RESP2 a plain array, as pub/sub uses.
+    void push_header(size_t length);
+    // RESP3 double (","); in RESP2 a bulk string.
+    void double_value(double value);
+    // RESP3 boolean ("#"); in RESP2 the integer 0 or 1.
+    void boolean(bool value);
+
+private:
+    void prefixed_integer(char prefix, int64_t value);
+
+    std::string &m_out;
+    int m_protocol;
+};
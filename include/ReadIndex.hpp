@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// A string value published for lock-free reads. It is owned by the ReadIndex
+// node that publishes it; the store entry only refers to it, and must not
+// modify it while readers may be active.
+struct PublishedString
+{
+    std::string *value;
+};
+
+// Hash index over the keyspace that readers search without a lock. Writers,
+// serialized by the caller, never modify a node that readers can reach: they
+// link in a replacement and retire the old node through epoch::retire, so a
+// reader inside an epoch::Guard sees every node whole, if possibly just
+// superseded. Growing the table clones the nodes into a new table for the
+// same reason.
+class ReadIndex
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Node
+    {
+        Node(const std::string &key, size_t hash, const std::string *value,
+             std::optional<Clock::time_point> expiry, uint32_t last_access)
+            : key(key), hash(hash), value(value), expiry(expiry), last_access(last_access)
+        {
+        }
+
+        const std::string key;
+        const size_t hash;
+        // Null if the value has to be read under the store lock.
+        const std::string *const value;
+        const std::optional<Clock::time_point> expiry;
+        // Refreshed by readers so the store can tell the key is in use.
+        mutable std::atomic<uint32_t> last_access;
+        std::atomic<Node *> next{nullptr};
+        bool owns_value{true}; // writers only
+    };
+
+    ReadIndex();
+    ~ReadIndex();
+
+    ReadIndex(const ReadIndex &) = delete;
+    ReadIndex &operator=(const ReadIndex &) = delete;
+
+    // For readers inside an epoch::Guard, and for writers. The node stays
+    // valid until the guard is released or the next write.
+    const Node *find(std::string_view key) const;
+
+    // Publishes the state of `key`. The index takes ownership of `value`,
+    // unless it is already the value of the key's current node.
+    void insert(const std::string &key, const std::string *value,
+                std::optional<Clock::time_point> expiry, uint32_t last_access);
+    void erase(const std::string &key);
+    // Drops every node; published values are freed once readers are done.
+    void clear();
+    size_t size() const { return m_size; }
+
+private:
+    struct Table
+    {
+        explicit Table(size_t bucket_count);
+        size_t mask;
+        std::unique_ptr<std::atomic<Node *>[]> buckets;
+    };
+
+    static constexpr size_t kInitialBuckets = 16;
+
+    static void delete_node(void *node);
+    static void delete_table(void *table);
+    void grow();
+
+    std::atomic<Table *> m_table;
+    size_t m_size{0};
+};
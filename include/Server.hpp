@@ -1,27 +1,115 @@
 #pragma once
 
 #include <atomic>
+#include <coroutine>
 #include <iostream>
+#include <mutex>
 #include <netinet/in.h>
 #include <string>
 #include <sys/socket.h>
 #include <unistd.h>
+#include <unordered_map>
+#include <vector>
 
+#include "Client.hpp"
 #include "DataStore.hpp"
+#include "EventLoop.hpp"
+#include "IOThreadPool.hpp"
+#include "KeyTracker.hpp"
+#include "PubSub.hpp"
+#include "RESPWriter.hpp"
 
 class Server
 {
 public:
-    Server(int port);
+    // By default every connection is a coroutine on a single event loop
+    // thread, which also runs every command; waiting for the socket or for a
+    // blocking command (BLPOP) only parks the coroutine. With io_threads > 0
+    // socket reads, request parsing and reply writes are instead spread over
+    // io_threads threads between single-threaded command execution phases.
+    // Port 0 binds an ephemeral port, see port().
+    Server(int port, int io_threads = 0);
     void start();
     void stop();
+    int port() const;
+    // Call before start().
+    void enable_tiering(DataStore::TieringOptions options);
+    // Call before start(); see DataStore::set_compression_threshold().
+    void set_compression_threshold(size_t threshold);
 
 private:
-    void handle_client(int client_socket);
-    void process_command(int client_socket, const std::vector<std::string> &command);
+    enum class WriteResult
+    {
+        Done,
+        Blocked, // non-blocking socket is full; retry when writable
+        Failed,
+    };
+
+    // Suspends a connection blocked in BLPOP/BRPOP until one of its keys
+    // changes, its deadline passes, its socket becomes readable (a hangup
+    // included) or the server stops. Messages pushed to it meanwhile are
+    // written out by flush() without resuming it.
+    class KeyWait
+    {
+    public:
+        KeyWait(Server &server, Client &client);
+        bool await_ready() { return false; }
+        void await_suspend(std::coroutine_handle<> handle);
+        void await_resume();
+        // Schedules the waiting connection; false if it already was.
+        bool resume();
+        void flush();
+
+    private:
+        Server &m_server;
+        Client &m_client;
+        std::coroutine_handle<> m_handle;
+        std::optional<EventLoop::TimerId> m_timer;
+        bool m_woken{false};
+    };
+
+    // Period of the housekeeping done by cron().
+    static constexpr std::chrono::milliseconds kCronInterval{100};
+
+    void serve_coroutines();
+    Task cron();
+    Task accept_connections();
+    Task serve_connection(int client_socket);
+    void wake_blocked(const std::string &key);
+    // Reads what the client sent without waiting; false once it hung up.
+    bool receive_pending(Client &client);
+    void serve_threaded_io();
+    void read_commands(Client &client);
+    // Runs a command, replying with an error instead of throwing.
+    void execute_command(Client &client, const std::vector<std::string> &command);
+    void process_command(Client &client, const std::vector<std::string> &command);
+    WriteResult write_output(Client &client);
+    void register_client(Client &client);
+    void unregister_client(Client &client);
+    std::string info(const std::string &section);
+    void blocking_pop(Client &client, const std::vector<std::string> &command, bool left, RESPWriter &reply);
+    void bitmap_command(Client &client, const std::vector<std::string> &command, const std::string &cmd,
+                        RESPWriter &reply);
+    void client_command(Client &client, const std::vector<std::string> &command, RESPWriter &reply);
 
     int m_server_socket{-1};
     int m_port;
+    int m_io_threads;
     std::atomic<bool> m_shutdown;
+    std::atomic<uint64_t> m_next_client_id{1};
     DataStore m_data_store;
+    PubSub m_pubsub;
+    KeyTracker m_tracker;
+
+    // Live connections by id, for CLIENT TRACKING ... REDIRECT.
+    std::mutex m_clients_mutex;
+    std::unordered_map<uint64_t, Client *> m_clients;
+
+    // Coroutine mode only; touched by the loop thread alone.
+    EventLoop m_loop;
+    std::vector<char> m_read_buffer;
+    bool m_accepting{false};
+    bool m_cron_running{false};
+    bool m_can_block{false};
+    std::unordered_map<std::string, std::vector<KeyWait *>> m_blocked;
 };
\ No newline at end of file
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+// Append-only log of values evicted from memory, split into segment files.
+// The in-memory index (the store) keeps a Location per spilled value and
+// reads it back with pread(). Released records become garbage; sealed
+// segments that are mostly garbage are compacted on a background thread,
+// which copies their live records to the head of the log and reports the
+// moves through take_relocations(). The log is scratch space, not
+// persistence: its files are deleted with it.
+class ValueLog
+{
+public:
+    static constexpr uint64_t kDefaultSegmentBytes = 32 * 1024 * 1024;
+    // Sealed segments with less than this share of live bytes are compacted.
+    static constexpr double kCompactLiveRatio = 0.5;
+
+    struct Location
+    {
+        uint32_t segment;
+        uint32_t length; // of the value
+        uint64_t offset; // of the value within the segment file
+
+        bool operator==(const Location &other) const = default;
+    };
+
+    struct Relocation
+    {
+        std::string key;
+        Location from;
+        Location to;
+    };
+
+    struct Stats
+    {
+        size_t segments;
+        uint64_t disk_bytes;
+        uint64_t live_bytes;
+        uint64_t compactions;
+    };
+
+    explicit ValueLog(const std::string &directory, uint64_t segment_bytes = kDefaultSegmentBytes);
+    ~ValueLog();
+
+    ValueLog(const ValueLog &) = delete;
+    ValueLog &operator=(const ValueLog &) = delete;
+
+    // All thread-safe. The key is stored alongside the value for compaction.
+    Location append(std::string_view key, std::string_view value);
+    std::string read(const Location &location) const;
+    void release(const Location &location);
+
+    // Moves made by compaction since the last call. The caller must, while
+    // no reads are in flight, repoint every index entry that still refers to
+    // `from` and release() `to` for all others; the compacted segments are
+    // deleted by this call.
+    std::vector<Relocation> take_relocations();
+
+    // Forgets every record, e.g. after the store was flushed.
+    void clear();
+
+    Stats stats() const;
+    // Blocks until no segment is due for compaction; for tests.
+    void wait_compacted();
+
+private:
+    struct Segment
+    {
+        Segment(uint32_t id, std::string path);
+        ~Segment(); // closes and deletes the file
+
+        const uint32_t id;
+        const std::string path;
+        int fd{-1};
+        uint64_t size{0};
+        uint64_t live_bytes{0};
+        uint64_t written_bytes{0};
+        bool sealed{false};
+        bool compacting{false};
+        std::unordered_set<uint64_t> dead; // value offsets of released records
+    };
+
+    std::shared_ptr<Segment> open_segment();
+    Location append_locked(std::string_view key, std::string_view value);
+    std::shared_ptr<Segment> compaction_candidate();
+    void schedule_compaction();
+    void compact(const std::shared_ptr<Segment> &segment, uint64_t generation);
+    void run();
+
+    const std::string m_directory;
+    const uint64_t m_segment_bytes;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_work_cv;
+    std::condition_variable m_idle_cv;
+    std::map<uint32_t, std::shared_ptr<Segment>> m_segments;
+    std::shared_ptr<Segment> m_active;
+    uint32_t m_next_segment{0};
+    uint64_t m_generation{0}; // bumped by clear() to void in-flight compactions
+    std::vector<Relocation> m_relocations;
+    std::vector<uint32_t> m_compacted; // segments to drop in take_relocations()
+    uint64_t m_compactions{0};
+    bool m_busy{false};
+    bool m_stop{false};
+    std::thread m_thread;
+};
@@ -0,0 +1,248 @@
+#include <cstring>
+
+#include "Bitmap.hpp"
+#include "CpuFeatures.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BITMAP_X86 1
+#endif
+
+namespace bitmap
+{
+    namespace
+    {
+        uint64_t load64(const uint8_t *data)
+        {
+            uint64_t word;
+            std::memcpy(&word, data, sizeof(word));
+            return word;
+        }
+
+        void store64(uint8_t *data, uint64_t word)
+        {
+            std::memcpy(data, &word, sizeof(word));
+        }
+
+        int first_bit_in_byte(uint8_t byte, bool bit)
+        {
+            uint8_t wanted = bit ? byte : static_cast<uint8_t>(~byte);
+            return __builtin_clz(static_cast<unsigned>(wanted)) - 24;
+        }
+
+        template <Op op>
+        uint64_t apply(uint64_t a, uint64_t b)
+        {
+            if constexpr (op == Op::And)
+            {
+                return a & b;
+            }
+            else if constexpr (op == Op::Or)
+            {
+                return a | b;
+            }
+            else
+            {
+                return a ^ b;
+            }
+        }
+
+        template <Op op>
+        void combine_words(uint8_t *target, const uint8_t *source, size_t size)
+        {
+            size_t i = 0;
+            for (; i + 8 <= size; i += 8)
+            {
+                store64(target + i, apply<op>(load64(target + i), load64(source + i)));
+            }
+            for (; i < size; i++)
+            {
+                target[i] = static_cast<uint8_t>(apply<op>(target[i], source[i]));
+            }
+        }
+    }
+
+    uint64_t count_scalar(const uint8_t *data, size_t size)
+    {
+        uint64_t total = 0;
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8)
+        {
+            total += static_cast<uint64_t>(__builtin_popcountll(load64(data + i)));
+        }
+        for (; i < size; i++)
+        {
+            total += static_cast<uint64_t>(__builtin_popcount(data[i]));
+        }
+        return total;
+    }
+
+    int64_t find_scalar(const uint8_t *data, size_t size, bool bit)
+    {
+        // Skip whole words that cannot contain the bit.
+        const uint64_t skip = bit ? 0 : ~uint64_t{0};
+        size_t i = 0;
+        while (i + 8 <= size && load64(data + i) == skip)
+        {
+            i += 8;
+        }
+        const uint8_t skip_byte = bit ? 0 : 0xff;
+        for (; i < size; i++)
+        {
+            if (data[i] != skip_byte)
+            {
+                return static_cast<int64_t>(i * 8 + first_bit_in_byte(data[i], bit));
+            }
+        }
+        return -1;
+    }
+
+    void combine_scalar(Op op, uint8_t *target, const uint8_t *source, size_t size)
+    {
+        switch (op)
+        {
+        case Op::And:
+            combine_words<Op::And>(target, source, size);
+            break;
+        case Op::Or:
+            combine_words<Op::Or>(target, source, size);
+            break;
+        case Op::Xor:
+            combine_words<Op::Xor>(target, source, size);
+            break;
+        }
+    }
+
+    void invert_scalar(uint8_t *data, size_t size)
+    {
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8)
+        {
+            store64(data + i, ~load64(data + i));
+        }
+        for (; i < size; i++)
+        {
+            data[i] = static_cast<uint8_t>(~data[i]);
+        }
+    }
+
+#ifdef BITMAP_X86
+    // Popcount by nibble lookup with vpshufb; vpsadbw folds the per-byte
+    // counts into four 64-bit lanes (Mula, Kurz and Lemire, 2016).
+    __attribute__((target("avx2"))) uint64_t count_avx2(const uint8_t *data, size_t size)
+    {
+        const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                                0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+        const __m256i low_mask = _mm256_set1_epi8(0x0f);
+        __m256i total = _mm256_setzero_si256();
+        size_t i = 0;
+        while (i + 32 <= size)
+        {
+            // Byte counters hold at most 8 per block, so 31 blocks fit before
+            // they have to be folded.
+            __m256i partial = _mm256_setzero_si256();
+            for (int block = 0; block < 31 && i + 32 <= size; block++, i += 32)
+            {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+                __m256i lo = _mm256_and_si256(v, low_mask);
+                __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+                partial = _mm256_add_epi8(partial, _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo),
+                                                                   _mm256_shuffle_epi8(lookup, hi)));
+            }
+            total = _mm256_add_epi64(total, _mm256_sad_epu8(partial, _mm256_setzero_si256()));
+        }
+        uint64_t lanes[4];
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(lanes), total);
+        return lanes[0] + lanes[1] + lanes[2] + lanes[3] + count_scalar(data + i, size - i);
+    }
+
+    __attribute__((target("avx2"))) int64_t find_avx2(const uint8_t *data, size_t size, bool bit)
+    {
+        const __m256i skip = bit ? _mm256_setzero_si256() : _mm256_set1_epi8(static_cast<char>(0xff));
+        size_t i = 0;
+        for (; i + 32 <= size; i += 32)
+        {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+            unsigned same = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, skip)));
+            if (same != 0xffffffffu)
+            {
+                size_t byte = i + __builtin_ctz(~same);
+                return static_cast<int64_t>(byte * 8 + first_bit_in_byte(data[byte], bit));
+            }
+        }
+        int64_t tail = find_scalar(data + i, size - i, bit);
+        return tail < 0 ? -1 : static_cast<int64_t>(i * 8) + tail;
+    }
+
+    __attribute__((target("avx2"))) void combine_avx2(Op op, uint8_t *target, const uint8_t *source, size_t size)
+    {
+        size_t i = 0;
+        for (; i + 32 <= size; i += 32)
+        {
+            __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(target + i));
+            __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(source + i));
+            __m256i result = op == Op::And  ? _mm256_and_si256(a, b)
+                             : op == Op::Or ? _mm256_or_si256(a, b)
+                                            : _mm256_xor_si256(a, b);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(target + i), result);
+        }
+        combine_scalar(op, target + i, source + i, size - i);
+    }
+
+    __attribute__((target("avx2"))) void invert_avx2(uint8_t *data, size_t size)
+    {
+        const __m256i ones = _mm256_set1_epi8(static_cast<char>(0xff));
+        size_t i = 0;
+        for (; i + 32 <= size; i += 32)
+        {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(data + i), _mm256_xor_si256(v, ones));
+        }
+        invert_scalar(data + i, size - i);
+    }
+#else
+    uint64_t count_avx2(const uint8_t *data, size_t size)
+    {
+        return count_scalar(data, size);
+    }
+
+    int64_t find_avx2(const uint8_t *data, size_t size, bool bit)
+    {
+        return find_scalar(data, size, bit);
+    }
+
+    void combine_avx2(Op op, uint8_t *target, const uint8_t *source, size_t size)
+    {
+        combine_scalar(op, target, source, size);
+    }
+
+    void invert_avx2(uint8_t *data, size_t size)
+    {
+        invert_scalar(data, size);
+    }
+#endif
+
+    uint64_t count(const uint8_t *data, size_t size)
+    {
+        static const auto kernel = cpu::has_avx2() ? count_avx2 : count_scalar;
+        return kernel(data, size);
+    }
+
+    int64_t find(const uint8_t *data, size_t size, bool bit)
+    {
+        static const auto kernel = cpu::has_avx2() ? find_avx2 : find_scalar;
+        return kernel(data, size, bit);
+    }
+
+    void combine(Op op, uint8_t *target, const uint8_t *source, size_t size)
+    {
+        static const auto kernel = cpu::has_avx2() ? combine_avx2 : combine_scalar;
+        kernel(op, target, source, size);
+    }
+
+    void invert(uint8_t *data, size_t size)
+    {
+        static const auto kernel = cpu::has_avx2() ? invert_avx2 : invert_scalar;
+        kernel(data, size);
+    }
+}
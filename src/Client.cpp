@@ -0,0 +1,98 @@
+#include <algorithm>
+#include <stdexcept>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "Client.hpp"
+
+Client::Client(uint64_t id, int socket, size_t push_limit) : id(id), socket(socket), m_push_limit(push_limit)
+{
+}
+
+Client::~Client()
+{
+    if (m_wake_fd >= 0)
+    {
+        close(m_wake_fd);
+    }
+}
+
+int Client::wake_fd()
+{
+    if (m_wake_fd < 0)
+    {
+        m_wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (m_wake_fd < 0)
+        {
+            throw std::runtime_error("Failed to create client wake fd");
+        }
+    }
+    return m_wake_fd;
+}
+
+void Client::deliver(std::shared_ptr<const std::string> message)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_push_mutex);
+        if (m_dropped)
+        {
+            return;
+        }
+
+        if (m_pushed_bytes + message->size() > m_push_limit)
+        {
+            // Drop the slow consumer instead of buffering without bound or
+            // making the publisher wait. Shutting the socket down also unblocks
+            // the connection thread if it is stuck in send().
+            m_dropped = true;
+            m_pushed.clear();
+            shutdown(socket, SHUT_RDWR);
+        }
+        else
+        {
+            m_pushed_bytes += message->size();
+            m_pushed.push_back(std::move(message));
+        }
+    }
+
+    if (m_wake_handler)
+    {
+        m_wake_handler();
+    }
+    else if (m_wake_fd >= 0)
+    {
+        uint64_t one = 1;
+        (void)!write(m_wake_fd, &one, sizeof(one));
+    }
+}
+
+void Client::clear_wake()
+{
+    uint64_t count;
+    (void)!read(m_wake_fd, &count, sizeof(count));
+}
+
+std::deque<std::shared_ptr<const std::string>> &Client::take_pushed()
+{
+    std::lock_guard<std::mutex> lock(m_push_mutex);
+    if (m_sending.empty())
+    {
+        m_sending.swap(m_pushed);
+    }
+    else
+    {
+        for (auto &message : m_pushed)
+        {
+            m_sending.push_back(std::move(message));
+        }
+        m_pushed.clear();
+    }
+    return m_sending;
+}
+
+void Client::release_pushed(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(m_push_mutex);
+    m_pushed_bytes -= std::min(bytes, m_pushed_bytes);
+}
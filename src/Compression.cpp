@@ -0,0 +1,282 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "Compression.hpp"
+
+namespace compression
+{
+    namespace
+    {
+        constexpr size_t kMinMatch = 4;
+        constexpr size_t kMaxOffset = 65535;
+        // Format rules that let decoders copy in whole words: the last five
+        // bytes are always literals and no match starts in the last twelve.
+        constexpr size_t kLastLiterals = 5;
+        constexpr size_t kMatchStartLimit = 12;
+        constexpr int kHashBits = 12;
+        // Output slack that lets match copies run past their end in whole
+        // chunks; it is trimmed off once decoding is done.
+        constexpr size_t kCopySlack = 32;
+
+        uint32_t load32(const uint8_t *data)
+        {
+            uint32_t word;
+            std::memcpy(&word, data, sizeof(word));
+            return word;
+        }
+
+        uint64_t load64(const uint8_t *data)
+        {
+            uint64_t word;
+            std::memcpy(&word, data, sizeof(word));
+            return word;
+        }
+
+        uint32_t hash(uint32_t sequence)
+        {
+            return (sequence * 2654435761u) >> (32 - kHashBits);
+        }
+
+        // Lengths past the 4-bit token field continue in bytes of up to 255.
+        uint8_t *write_length(uint8_t *out, size_t length)
+        {
+            for (; length >= 255; length -= 255)
+            {
+                *out++ = 255;
+            }
+            *out++ = static_cast<uint8_t>(length);
+            return out;
+        }
+
+        size_t read_length(const uint8_t *&in, const uint8_t *end)
+        {
+            size_t length = 0;
+            uint8_t byte;
+            do
+            {
+                if (in == end)
+                {
+                    throw std::runtime_error("corrupt compressed value");
+                }
+                byte = *in++;
+                length += byte;
+            } while (byte == 255);
+            return length;
+        }
+
+        uint8_t *write_sequence(uint8_t *out, const uint8_t *literals, size_t literal_length,
+                                size_t offset, size_t match_length)
+        {
+            uint8_t *token = out++;
+            *token = static_cast<uint8_t>(std::min<size_t>(literal_length, 15) << 4);
+            if (literal_length >= 15)
+            {
+                out = write_length(out, literal_length - 15);
+            }
+            std::memcpy(out, literals, literal_length);
+            out += literal_length;
+            if (match_length == 0)
+            {
+                return out; // the closing literal run
+            }
+            *out++ = static_cast<uint8_t>(offset);
+            *out++ = static_cast<uint8_t>(offset >> 8);
+            size_t extra = match_length - kMinMatch;
+            *token |= static_cast<uint8_t>(std::min<size_t>(extra, 15));
+            if (extra >= 15)
+            {
+                out = write_length(out, extra - 15);
+            }
+            return out;
+        }
+    }
+
+    std::string lz_compress(std::string_view input)
+    {
+        const auto *src = reinterpret_cast<const uint8_t *>(input.data());
+        const size_t size = input.size();
+        std::string out(size + size / 255 + 16, '\0');
+        auto *dst = reinterpret_cast<uint8_t *>(out.data());
+        uint8_t *op = dst;
+
+        size_t anchor = 0;
+        if (size > kMatchStartLimit)
+        {
+            uint32_t table[1 << kHashBits] = {};
+            const size_t match_end = size - kLastLiterals;
+            const size_t search_end = size - kMatchStartLimit;
+            size_t ip = 1;
+            while (ip < search_end)
+            {
+                uint32_t sequence = load32(src + ip);
+                uint32_t &slot = table[hash(sequence)];
+                size_t candidate = slot;
+                slot = static_cast<uint32_t>(ip);
+                if (ip - candidate > kMaxOffset || load32(src + candidate) != sequence)
+                {
+                    // step faster through data that keeps failing to match
+                    ip += 1 + ((ip - anchor) >> 6);
+                    continue;
+                }
+
+                while (ip > anchor && candidate > 0 && src[ip - 1] == src[candidate - 1])
+                {
+                    ip--;
+                    candidate--;
+                }
+                size_t length = kMinMatch;
+                while (ip + length + 8 <= match_end &&
+                       load64(src + ip + length) == load64(src + candidate + length))
+                {
+                    length += 8;
+                }
+                while (ip + length < match_end && src[ip + length] == src[candidate + length])
+                {
+                    length++;
+                }
+
+                op = write_sequence(op, src + anchor, ip - anchor, ip - candidate, length);
+                ip += length;
+                anchor = ip;
+            }
+        }
+        op = write_sequence(op, src + anchor, size - anchor, 0, 0);
+        out.resize(static_cast<size_t>(op - dst));
+        return out;
+    }
+
+    std::string lz_decompress(std::string_view data, size_t size)
+    {
+        // A sequence expands its bytes at most 255 times; a larger size
+        // is corrupt and not worth allocating.
+        if (size / 255 > data.size())
+        {
+            throw std::runtime_error("corrupt compressed value");
+        }
+        std::string out(size + kCopySlack, '\0');
+        const auto *ip = reinterpret_cast<const uint8_t *>(data.data());
+        const uint8_t *in_end = ip + data.size();
+        auto *begin = reinterpret_cast<uint8_t *>(out.data());
+        uint8_t *op = begin;
+        uint8_t *out_end = begin + size;
+        auto corrupt = []()
+        {
+            throw std::runtime_error("corrupt compressed value");
+        };
+
+        while (true)
+        {
+            if (ip == in_end)
+            {
+                corrupt();
+            }
+            uint8_t token = *ip++;
+            size_t literals = token >> 4;
+            if (literals == 15)
+            {
+                literals += read_length(ip, in_end);
+            }
+            if (literals > static_cast<size_t>(in_end - ip) || literals > static_cast<size_t>(out_end - op))
+            {
+                corrupt();
+            }
+            std::memcpy(op, ip, literals);
+            op += literals;
+            ip += literals;
+            if (ip == in_end)
+            {
+                break;
+            }
+
+            if (in_end - ip < 2)
+            {
+                corrupt();
+            }
+            size_t offset = ip[0] | static_cast<size_t>(ip[1]) << 8;
+            ip += 2;
+            size_t length = (token & 15) + kMinMatch;
+            if ((token & 15) == 15)
+            {
+                length += read_length(ip, in_end);
+            }
+            if (offset == 0 || offset > static_cast<size_t>(op - begin) || length > static_cast<size_t>(out_end - op))
+            {
+                corrupt();
+            }
+
+            // Matches may overlap their own output, so chunks can be no wider
+            // than the distance back to the source.
+            const uint8_t *match = op - offset;
+            uint8_t *copy_end = op + length;
+            if (offset >= 16)
+            {
+                for (; op < copy_end; op += 16, match += 16)
+                {
+                    std::memcpy(op, match, 16);
+                }
+            }
+            else if (offset >= 8)
+            {
+                for (; op < copy_end; op += 8, match += 8)
+                {
+                    std::memcpy(op, match, 8);
+                }
+            }
+            else
+            {
+                while (op < copy_end)
+                {
+                    *op++ = *match++;
+                }
+            }
+            op = copy_end;
+        }
+        if (op != out_end)
+        {
+            corrupt();
+        }
+        out.resize(size);
+        return out;
+    }
+
+    std::optional<Block> compress(std::string_view input, Codec codec)
+    {
+        Block block{codec, input.size(), {}};
+        switch (codec)
+        {
+        case Codec::LZ:
+            block.data = lz_compress(input);
+            break;
+        }
+        if (block.data.size() >= input.size())
+        {
+            return std::nullopt;
+        }
+        block.data.shrink_to_fit();
+        return block;
+    }
+
+    std::string decompress(const Block &block)
+    {
+        switch (block.codec)
+        {
+        case Codec::LZ:
+            return lz_decompress(block.data, block.size);
+        }
+        throw std::runtime_error("unknown compression codec");
+    }
+
+    bool is_valid(const Block &block)
+    {
+        try
+        {
+            decompress(block);
+            return true;
+        }
+        catch (const std::runtime_error &)
+        {
+            return false;
+        }
+    }
+}
@@ -1,32 +1,342 @@
+#include <algorithm>
+#include <cstring>
 #include <fstream>
+#include <stdexcept>
+#include <utility>
 
+#include "Bitmap.hpp"
 #include "DataStore.hpp"
+#include "Epoch.hpp"
+
+namespace
+{
+    // Unrelated objects that freeing a value touches; strings are one block.
+    constexpr size_t kUnlinkLazyFreeEffort = 64;
+
+    template <typename Value>
+    size_t free_effort(const Value &value)
+    {
+        if (auto *list = std::get_if<std::list<compression::Packed>>(&value))
+        {
+            return list->size();
+        }
+        return 1;
+    }
+
+    size_t packed_capacity(const compression::Packed &element)
+    {
+        if (auto *block = std::get_if<compression::Block>(&element))
+        {
+            return block->data.capacity();
+        }
+        return std::get<std::string>(element).capacity();
+    }
+
+    // The string held by a plain or a published string value, or nullptr.
+    template <typename Value>
+    const std::string *string_value(const Value &value)
+    {
+        if (auto *published = std::get_if<PublishedString>(&value))
+        {
+            return published->value;
+        }
+        return std::get_if<std::string>(&value);
+    }
+
+    // O(1) estimate of the heap bytes held by a value, extrapolated from a few
+    // list elements so the store lock is never held for a full walk.
+    template <typename Value>
+    size_t estimate_bytes(const Value &value)
+    {
+        if (auto *str = string_value(value))
+        {
+            return str->capacity();
+        }
+        if (auto *hll = std::get_if<HyperLogLog>(&value))
+        {
+            return hll->bytes();
+        }
+        if (auto *block = std::get_if<compression::Block>(&value))
+        {
+            return block->data.capacity();
+        }
+        auto *spilled = std::get_if<ValueLog::Location>(&value);
+        if (spilled)
+        {
+            return 0;
+        }
+        auto &list = std::get<std::list<compression::Packed>>(value);
+        constexpr size_t kNodeOverhead = sizeof(compression::Packed) + 2 * sizeof(void *);
+        size_t sampled = 0;
+        size_t sampled_bytes = 0;
+        for (auto it = list.begin(); it != list.end() && sampled < 16; ++it, ++sampled)
+        {
+            size_t capacity = packed_capacity(*it);
+            sampled_bytes += kNodeOverhead + (capacity > 15 ? capacity : 0);
+        }
+        return sampled == 0 ? 0 : sampled_bytes / sampled * list.size();
+    }
+
+    // Spilled values are a type byte followed by the string, the list
+    // elements each prefixed with its u32 length, the serialized counter, or
+    // a compressed string's codec byte, u64 length and compressed bytes. A
+    // compressed list element sets the top bit of its length and is encoded
+    // like a compressed string.
+    constexpr char kSpilledString = 0;
+    constexpr char kSpilledList = 1;
+    constexpr char kSpilledHyperLogLog = 2;
+    constexpr char kSpilledCompressed = 3;
+    constexpr uint32_t kCompressedElement = uint32_t{1} << 31;
+
+    void encode_block(std::string &out, const compression::Block &block)
+    {
+        uint64_t size = block.size;
+        out += static_cast<char>(block.codec);
+        out.append(reinterpret_cast<const char *>(&size), sizeof(size));
+        out += block.data;
+    }
+
+    compression::Block decode_block(std::string_view data)
+    {
+        uint64_t size;
+        std::memcpy(&size, data.data() + 1, sizeof(size));
+        return compression::Block{static_cast<compression::Codec>(data[0]), size,
+                                  std::string(data.substr(1 + sizeof(size)))};
+    }
+
+    const char *kWrongTypeHyperLogLog = "WRONGTYPE Key is not a valid HyperLogLog value.";
+    const char *kWrongType = "WRONGTYPE Operation against a key holding the wrong kind of value";
+
+    // Clamps an inclusive range, negative ends counting back from `length`,
+    // into [0, length). Returns false if nothing is left.
+    bool clamp_range(int64_t &start, int64_t &end, int64_t length)
+    {
+        if (start < 0)
+            start = std::max<int64_t>(length + start, 0);
+        if (end < 0)
+            end = std::max<int64_t>(length + end, 0);
+        if (end >= length)
+            end = length - 1;
+        return length > 0 && start <= end;
+    }
+
+    // Masks for the bits from `first` to the end of its byte, and from the
+    // start of its byte through `last`.
+    uint8_t head_mask(uint64_t first) { return static_cast<uint8_t>(0xff >> (first & 7)); }
+    uint8_t tail_mask(uint64_t last) { return static_cast<uint8_t>(0xff << (7 - (last & 7))); }
+
+    // Set bits among bits first..last; whole bytes go to the bitmap kernel.
+    uint64_t count_bits(const uint8_t *data, uint64_t first, uint64_t last)
+    {
+        size_t first_byte = first >> 3;
+        size_t last_byte = last >> 3;
+        if (first_byte == last_byte)
+        {
+            return __builtin_popcount(data[first_byte] & head_mask(first) & tail_mask(last));
+        }
+        return __builtin_popcount(data[first_byte] & head_mask(first)) +
+               bitmap::count(data + first_byte + 1, last_byte - first_byte - 1) +
+               __builtin_popcount(data[last_byte] & tail_mask(last));
+    }
+
+    // First bit equal to `bit` among bits first..last, or -1.
+    int64_t find_bit(const uint8_t *data, uint64_t first, uint64_t last, bool bit)
+    {
+        // bits outside the range read as the opposite of what is searched for
+        auto edge = [&](size_t index, uint8_t keep)
+        {
+            uint8_t byte = data[index];
+            byte = bit ? (byte & keep) : (byte | static_cast<uint8_t>(~keep));
+            int64_t pos = bitmap::find(&byte, 1, bit);
+            return pos < 0 ? -1 : static_cast<int64_t>(index * 8) + pos;
+        };
+        size_t first_byte = first >> 3;
+        size_t last_byte = last >> 3;
+        if (first_byte == last_byte)
+        {
+            return edge(first_byte, head_mask(first) & tail_mask(last));
+        }
+        int64_t pos = edge(first_byte, head_mask(first));
+        if (pos >= 0)
+        {
+            return pos;
+        }
+        pos = bitmap::find(data + first_byte + 1, last_byte - first_byte - 1, bit);
+        if (pos >= 0)
+        {
+            return static_cast<int64_t>((first_byte + 1) * 8) + pos;
+        }
+        return edge(last_byte, tail_mask(last));
+    }
+
+    // The bits covered by `range` in a string of `size` bytes.
+    bool bit_span(const DataStore::BitRange &range, size_t size, uint64_t &first, uint64_t &last)
+    {
+        int64_t start = range.start;
+        int64_t end = range.end.value_or(-1);
+        int64_t length = static_cast<int64_t>(size) * (range.bits ? 8 : 1);
+        if (!clamp_range(start, end, length))
+        {
+            return false;
+        }
+        first = range.bits ? start : start * 8;
+        last = range.bits ? end : end * 8 + 7;
+        return true;
+    }
+
+    template <typename Value>
+    std::string encode_value(const Value &value)
+    {
+        std::string out;
+        if (auto *str = string_value(value))
+        {
+            out.reserve(1 + str->size());
+            out += kSpilledString;
+            out += *str;
+            return out;
+        }
+        if (auto *hll = std::get_if<HyperLogLog>(&value))
+        {
+            out += kSpilledHyperLogLog;
+            out += hll->serialize();
+            return out;
+        }
+        if (auto *block = std::get_if<compression::Block>(&value))
+        {
+            out += kSpilledCompressed;
+            encode_block(out, *block);
+            return out;
+        }
+        out += kSpilledList;
+        for (const auto &element : std::get<std::list<compression::Packed>>(value))
+        {
+            size_t start = out.size();
+            uint32_t length = 0;
+            out.append(reinterpret_cast<const char *>(&length), sizeof(length));
+            if (auto *block = std::get_if<compression::Block>(&element))
+            {
+                encode_block(out, *block);
+                length = kCompressedElement;
+            }
+            else
+            {
+                out += std::get<std::string>(element);
+            }
+            length |= static_cast<uint32_t>(out.size() - start - sizeof(length));
+            std::memcpy(&out[start], &length, sizeof(length));
+        }
+        return out;
+    }
+
+    template <typename Value>
+    Value decode_value(const std::string &data)
+    {
+        if (data.empty() || data[0] == kSpilledString)
+        {
+            return data.empty() ? std::string() : data.substr(1);
+        }
+        if (data[0] == kSpilledHyperLogLog)
+        {
+            return HyperLogLog::deserialize(std::string_view(data).substr(1));
+        }
+        if (data[0] == kSpilledCompressed)
+        {
+            return decode_block(std::string_view(data).substr(1));
+        }
+        std::list<compression::Packed> list;
+        size_t pos = 1;
+        while (pos + sizeof(uint32_t) <= data.size())
+        {
+            uint32_t length;
+            std::memcpy(&length, data.data() + pos, sizeof(length));
+            pos += sizeof(length);
+            auto element = std::string_view(data).substr(pos, length & ~kCompressedElement);
+            if (length & kCompressedElement)
+            {
+                list.emplace_back(decode_block(element));
+            }
+            else
+            {
+                list.emplace_back(std::string(element));
+            }
+            pos += element.size();
+        }
+        return list;
+    }
+}
 
 void DataStore::set(const std::string &key, const std::string &value, std::optional<std::chrono::milliseconds> expire_time)
 {
-    std::lock_guard<std::mutex> lock(m_store_mutex);
+    auto lock = lock_store();
     ValueEntry entry;
-    entry.value = value;
+    entry.value = pack_string(value);
+    entry.last_access = m_access_clock;
     if (expire_time.has_value())
     {
         entry.expiry = std::chrono::steady_clock::now() + expire_time.value();
     }
-    m_store[key] = std::move(entry);
+    auto [it, inserted] = m_store.try_emplace(key);
+    if (!inserted)
+    {
+        dispose(std::move(it->second.value), m_lazyfree_threshold);
+    }
+    it->second = std::move(entry);
+    m_key_stats.record_access(key);
+    track_size(key, it->second);
+    index_update(key, true);
+    notify_modified(key);
 }
 
 std::string DataStore::get(const std::string &key)
 {
-    std::lock_guard<std::mutex> lock(m_store_mutex);
+    m_key_stats.record_access(key);
+    if (!m_single_threaded)
+    {
+        epoch::Guard guard;
+        const ReadIndex::Node *node = m_index.find(key);
+        if (!node)
+        {
+            return "";
+        }
+        // anything else, expired keys included, is left to the locked path
+        if (node->value && (!node->expiry || std::chrono::steady_clock::now() <= *node->expiry))
+        {
+            uint32_t now = m_access_clock.load(std::memory_order_relaxed);
+            if (node->last_access.load(std::memory_order_relaxed) != now)
+            {
+                node->last_access.store(now, std::memory_order_relaxed);
+            }
+            return *node->value;
+        }
+    }
+
+    auto lock = lock_store();
     auto it = m_store.find(key);
 
     if (it != m_store.end())
     {
         if (is_expired_entry(it->second))
         {
+            dispose(std::move(it->second.value), m_lazyfree_threshold);
             m_store.erase(it);
+            m_key_stats.record_removal(key);
+            notify_modified(key);
             return "";
         }
-        return std::get<std::string>(it->second.value);
+        touch(it->second);
+        if (auto *block = std::get_if<compression::Block>(&it->second.value))
+        {
+            return unpack_string(*block);
+        }
+        // a string read back from disk or modified in place: serve the
+        // next read without the lock
+        index_update(key, true);
+        const std::string *str = string_value(it->second.value);
+        if (!str)
+        {
+            throw std::runtime_error(kWrongType);
+        }
+        return *str;
     }
 
     return "";
@@ -34,7 +344,15 @@ std::string DataStore::get(const std::string &key)
 
 bool DataStore::exists(const std::string &key)
 {
-    std::lock_guard<std::mutex> lock(m_store_mutex);
+    m_key_stats.record_access(key);
+    if (!m_single_threaded)
+    {
+        epoch::Guard guard;
+        const ReadIndex::Node *node = m_index.find(key);
+        return node && (!node->expiry || std::chrono::steady_clock::now() <= *node->expiry);
+    }
+
+    auto lock = lock_store();
     auto it = m_store.find(key);
     if (it != m_store.end() &&
         !is_expired_entry(it->second))
@@ -46,24 +364,62 @@ bool DataStore::exists(const std::string &key)
 
 bool DataStore::del(const std::string &key)
 {
-    std::lock_guard<std::mutex> lock(m_store_mutex);
-    auto it = m_store.find(key);
-    return m_store.erase(key) > 0;
+    auto lock = lock_store();
+    return remove(key, m_lazyfree_threshold);
+}
+
+bool DataStore::unlink(const std::string &key)
+{
+    auto lock = lock_store();
+    return remove(key, kUnlinkLazyFreeEffort);
+}
+
+void DataStore::flushall(bool async)
+{
+    auto lock = lock_store();
+    if (async && !m_store.empty())
+    {
+        // Moving the table out is O(1); the worker walks and frees it.
+        size_t bytes = m_store.bucket_count() * sizeof(void *);
+        size_t sampled = 0;
+        size_t sampled_bytes = 0;
+        for (auto it = m_store.begin(); it != m_store.end() && sampled < 16; ++it, ++sampled)
+        {
+            sampled_bytes += sizeof(*it) + it->first.capacity() + estimate_bytes(it->second.value);
+        }
+        bytes += sampled_bytes / sampled * m_store.size();
+        m_lazy_free.free_later(std::move(m_store), bytes);
+    }
+    m_store.clear();
+    m_index.clear();
+    m_key_stats.clear_sizes();
+    if (m_value_log)
+    {
+        m_value_log->clear();
+        m_spilled_keys = 0;
+        m_spilled_bytes = 0;
+    }
+    if (m_flush_listener)
+    {
+        m_flush_listener();
+    }
 }
 
 int DataStore::incr(const std::string &key)
 {
-    std::lock_guard<std::mutex> lock(m_store_mutex);
+    auto lock = lock_store();
     auto it = m_store.find(key);
     int value = 0;
     if (it != m_store.end() &&
         !is_expired_entry(it->second))
     {
-        if (std::holds_alternative<std::string>(it->second.value))
+        touch(it->second);
+        inflate(it->second);
+        if (const std::string *str = string_value(it->second.value))
         {
             try
             {
-                value = std::stoi(std::get<std::string>(it->second.value));
+                value = std::stoi(*str);
             }
             catch (const std::exception &)
             {
@@ -76,23 +432,30 @@ int DataStore::incr(const std::string &key)
         }
     }
     value += 1;
-    m_store[key].value = std::to_string(value);
+    auto &entry = m_store[key];
+    entry.value = std::to_string(value);
+    m_key_stats.record_access(key);
+    track_size(key, entry);
+    index_update(key, true);
+    notify_modified(key);
     return value;
 }
 
 int DataStore::decr(const std::string &key)
 {
-    std::lock_guard<std::mutex> lock(m_store_mutex);
+    auto lock = lock_store();
     auto it = m_store.find(key);
     int value = 0;
     if (it != m_store.end() &&
         !is_expired_entry(it->second))
     {
-        if (std::holds_alternative<std::string>(it->second.value))
+        touch(it->second);
+        inflate(it->second);
+        if (const std::string *str = string_value(it->second.value))
         {
             try
             {
-                value = std::stoi(std::get<std::string>(it->second.value));
+                value = std::stoi(*str);
             }
             catch (const std::exception &)
             {
@@ -105,49 +468,64 @@ int DataStore::decr(const std::string &key)
         }
     }
     value -= 1;
-    m_store[key].value = std::to_string(value);
+    auto &entry = m_store[key];
+    entry.value = std::to_string(value);
+    m_key_stats.record_access(key);
+    track_size(key, entry);
+    index_update(key, true);
+    notify_modified(key);
     return value;
 }
 
 int DataStore::lpush(const std::string &key, const std::string &value)
 {
-    std::lock_guard<std::mutex> lock(m_store_mutex);
+    auto lock = lock_store();
     auto &entry = m_store[key];
+    touch(entry);
 
-    if (!std::holds_alternative<std::list<std::string>>(entry.value))
+    if (!std::holds_alternative<std::list<compression::Packed>>(entry.value))
     {
-        entry.value = std::list<std::string>{};
+        entry.value = std::list<compression::Packed>{};
     }
-    auto &list = std::get<std::list<std::string>>(entry.value);
-    list.push_front(value);
+    auto &list = std::get<std::list<compression::Packed>>(entry.value);
+    list.push_front(pack(value));
+    m_key_stats.record_access(key);
+    track_size(key, entry);
+    notify_modified(key);
     return static_cast<int>(list.size());
 }
 
 int DataStore::rpush(const std::string &key, const std::string &value)
 {
-    std::lock_guard<std::mutex> lock(m_store_mutex);
+    auto lock = lock_store();
     auto &entry = m_store[key];
+    touch(entry);
 
-    if (!std::holds_alternative<std::list<std::string>>(entry.value))
+    if (!std::holds_alternative<std::list<compression::Packed>>(entry.value))
     {
-        entry.value = std::list<std::string>{};
+        entry.value = std::list<compression::Packed>{};
     }
-    auto &list = std::get<std::list<std::string>>(entry.value);
-    list.push_back(value);
+    auto &list = std::get<std::list<compression::Packed>>(entry.value);
+    list.push_back(pack(value));
+    m_key_stats.record_access(key);
+    track_size(key, entry);
+    notify_modified(key);
     return static_cast<int>(list.size());
 }
 
 std::vector<std::string> DataStore::lrange(const std::string &key, int start, int stop)
 {
-    std::lock_guard<std::mutex> lock(m_store_mutex);
+    auto lock = lock_store();
+    m_key_stats.record_access(key);
     auto it = m_store.find(key);
 
     if (it != m_store.end() &&
         !is_expired_entry(it->second))
     {
-        if (std::holds_alternative<std::list<std::string>>(it->second.value))
+        touch(it->second);
+        if (std::holds_alternative<std::list<compression::Packed>>(it->second.value))
         {
-            auto &list = std::get<std::list<std::string>>(it->second.value);
+            auto &list = std::get<std::list<compression::Packed>>(it->second.value);
             std::vector<std::string> result;
             int list_size = static_cast<int>(list.size());
 
@@ -162,16 +540,259 @@ std::vector<std::string> DataStore::lrange(const std::string &key, int start, in
 
             auto it_start = std::next(list.begin(), start);
             auto it_end = std::next(list.begin(), stop + 1);
-            result.assign(it_start, it_end);
+            for (auto element = it_start; element != it_end; ++element)
+            {
+                result.push_back(unpack(*element));
+            }
             return result;
         }
     }
     return {};
 }
 
+std::optional<std::string> DataStore::lpop(const std::string &key)
+{
+    auto lock = lock_store();
+    return pop(key, true);
+}
+
+std::optional<std::string> DataStore::rpop(const std::string &key)
+{
+    auto lock = lock_store();
+    return pop(key, false);
+}
+
+bool DataStore::pfadd(const std::string &key, const std::vector<std::string> &elements)
+{
+    auto lock = lock_store();
+    m_key_stats.record_access(key);
+    HyperLogLog *hll = find_hyperloglog(key);
+    bool changed = false;
+    if (!hll)
+    {
+        auto &entry = m_store[key];
+        dispose(std::exchange(entry.value, HyperLogLog()), m_lazyfree_threshold);
+        entry.expiry.reset();
+        entry.last_access = m_access_clock;
+        hll = &std::get<HyperLogLog>(entry.value);
+        changed = true;
+    }
+    for (const auto &element : elements)
+    {
+        changed |= hll->add(element);
+    }
+    if (changed)
+    {
+        track_size(key, m_store[key]);
+        notify_modified(key);
+    }
+    return changed;
+}
+
+uint64_t DataStore::pfcount(const std::vector<std::string> &keys)
+{
+    auto lock = lock_store();
+    if (keys.size() == 1)
+    {
+        m_key_stats.record_access(keys[0]);
+        HyperLogLog *hll = find_hyperloglog(keys[0]);
+        return hll ? hll->count() : 0;
+    }
+    HyperLogLog merged;
+    for (const auto &key : keys)
+    {
+        m_key_stats.record_access(key);
+        if (HyperLogLog *hll = find_hyperloglog(key))
+        {
+            merged.merge(*hll);
+        }
+    }
+    return merged.count();
+}
+
+void DataStore::pfmerge(const std::string &dest, const std::vector<std::string> &sources)
+{
+    auto lock = lock_store();
+    HyperLogLog merged;
+    // look everything up first: a wrong type anywhere fails the whole merge
+    std::vector<HyperLogLog *> inputs;
+    for (const auto &key : sources)
+    {
+        m_key_stats.record_access(key);
+        if (HyperLogLog *hll = find_hyperloglog(key))
+        {
+            inputs.push_back(hll);
+        }
+    }
+    m_key_stats.record_access(dest);
+    if (HyperLogLog *hll = find_hyperloglog(dest))
+    {
+        inputs.push_back(hll);
+    }
+    for (HyperLogLog *hll : inputs)
+    {
+        merged.merge(*hll);
+    }
+
+    auto &entry = m_store[dest];
+    bool keep_expiry = std::holds_alternative<HyperLogLog>(entry.value);
+    dispose(std::exchange(entry.value, std::move(merged)), m_lazyfree_threshold);
+    if (!keep_expiry)
+    {
+        entry.expiry.reset();
+    }
+    entry.last_access = m_access_clock;
+    track_size(dest, entry);
+    notify_modified(dest);
+}
+
+int DataStore::setbit(const std::string &key, uint64_t offset, bool bit)
+{
+    auto lock = lock_store();
+    m_key_stats.record_access(key);
+    std::string *str = find_string(key);
+    if (!str)
+    {
+        auto &entry = m_store[key];
+        entry.last_access = m_access_clock;
+        str = &std::get<std::string>(entry.value);
+    }
+    size_t byte = offset >> 3;
+    if (byte >= str->size())
+    {
+        str->resize(byte + 1, '\0');
+    }
+    auto mask = static_cast<char>(0x80 >> (offset & 7));
+    int previous = ((*str)[byte] & mask) ? 1 : 0;
+    if (bit)
+    {
+        (*str)[byte] |= mask;
+    }
+    else
+    {
+        (*str)[byte] &= static_cast<char>(~mask);
+    }
+    track_size(key, m_store[key]);
+    notify_modified(key);
+    return previous;
+}
+
+int DataStore::getbit(const std::string &key, uint64_t offset)
+{
+    auto lock = lock_store();
+    m_key_stats.record_access(key);
+    std::string unpacked;
+    const std::string *str = read_string(key, unpacked);
+    size_t byte = offset >> 3;
+    if (!str || byte >= str->size())
+    {
+        return 0;
+    }
+    return ((*str)[byte] & (0x80 >> (offset & 7))) ? 1 : 0;
+}
+
+uint64_t DataStore::bitcount(const std::string &key, const BitRange &range)
+{
+    auto lock = lock_store();
+    m_key_stats.record_access(key);
+    std::string unpacked;
+    const std::string *str = read_string(key, unpacked);
+    uint64_t first, last;
+    if (!str || !bit_span(range, str->size(), first, last))
+    {
+        return 0;
+    }
+    return count_bits(reinterpret_cast<const uint8_t *>(str->data()), first, last);
+}
+
+int64_t DataStore::bitpos(const std::string &key, bool bit, const BitRange &range)
+{
+    auto lock = lock_store();
+    m_key_stats.record_access(key);
+    std::string unpacked;
+    const std::string *str = read_string(key, unpacked);
+    if (!str)
+    {
+        // a missing key is an empty string, zero-padded to the right
+        return bit ? -1 : 0;
+    }
+    uint64_t first, last;
+    if (!bit_span(range, str->size(), first, last))
+    {
+        return -1;
+    }
+    int64_t pos = find_bit(reinterpret_cast<const uint8_t *>(str->data()), first, last, bit);
+    if (pos < 0 && !bit && !range.end)
+    {
+        return static_cast<int64_t>(str->size() * 8);
+    }
+    return pos;
+}
+
+size_t DataStore::bitop(BitOp op, const std::string &dest, const std::vector<std::string> &sources)
+{
+    auto lock = lock_store();
+    // look everything up first: a wrong type anywhere fails the whole operation
+    std::vector<const std::string *> inputs;
+    std::vector<std::string> unpacked(sources.size());
+    size_t longest = 0;
+    for (size_t i = 0; i < sources.size(); i++)
+    {
+        const auto &key = sources[i];
+        m_key_stats.record_access(key);
+        const std::string *str = read_string(key, unpacked[i]);
+        inputs.push_back(str);
+        longest = std::max(longest, str ? str->size() : 0);
+    }
+
+    std::string result;
+    if (longest > 0)
+    {
+        if (inputs[0])
+        {
+            result = *inputs[0];
+        }
+        result.resize(longest, '\0');
+        auto *target = reinterpret_cast<uint8_t *>(result.data());
+        if (op == BitOp::Not)
+        {
+            bitmap::invert(target, longest);
+        }
+        for (size_t i = 1; i < inputs.size() && op != BitOp::Not; i++)
+        {
+            size_t size = inputs[i] ? inputs[i]->size() : 0;
+            auto *source = reinterpret_cast<const uint8_t *>(size ? inputs[i]->data() : nullptr);
+            bitmap::combine(op == BitOp::And  ? bitmap::Op::And
+                            : op == BitOp::Or ? bitmap::Op::Or
+                                              : bitmap::Op::Xor,
+                            target, source, size);
+            if (op == BitOp::And)
+            {
+                std::memset(target + size, 0, longest - size);
+            }
+        }
+    }
+
+    m_key_stats.record_access(dest);
+    if (result.empty())
+    {
+        remove(dest, m_lazyfree_threshold);
+        return 0;
+    }
+    auto &entry = m_store[dest];
+    dispose(std::exchange(entry.value, std::move(result)), m_lazyfree_threshold);
+    entry.expiry.reset();
+    entry.last_access = m_access_clock;
+    size_t length = std::get<std::string>(entry.value).size();
+    track_size(dest, entry);
+    index_update(dest, true);
+    notify_modified(dest);
+    return length;
+}
+
 bool DataStore::save(const std::string &filename)
 {
-    std::lock_guard<std::mutex> lock(m_store_mutex);
+    auto lock = lock_store();
 
     std::ofstream ofs(filename, std::ios::binary);
 
@@ -190,16 +811,73 @@ bool DataStore::save(const std::string &filename)
         ofs.write(reinterpret_cast<const char *>(&key_size), sizeof(key_size));
         ofs.write(key.data(), key_size);
 
-        if (std::holds_alternative<std::string>(entry.value))
+        // spilled values are read from the log without moving them back
+        const ValueEntry::ValueType *stored = &entry.value;
+        ValueEntry::ValueType loaded;
+        if (auto *location = std::get_if<ValueLog::Location>(&entry.value))
+        {
+            loaded = decode_value<ValueEntry::ValueType>(m_value_log->read(*location));
+            stored = &loaded;
+        }
+
+        // Values are written as they are held, compressed Blocks included:
+        // compressing here would hold the store lock for it. Large plain
+        // strings are compressed when the snapshot is loaded instead.
+        if (auto *str = string_value(*stored))
         {
             char type = 0; // type 0 for string
             ofs.write(&type, sizeof(type));
 
-            auto &value = std::get<std::string>(entry.value);
+            auto &value = *str;
+            size_t value_size = value.size();
+            ofs.write(reinterpret_cast<const char *>(&value_size), sizeof(value_size));
+            ofs.write(value.data(), value_size);
+        }
+        else if (auto *hll = std::get_if<HyperLogLog>(stored))
+        {
+            char type = 2; // type 2 for HyperLogLog
+            ofs.write(&type, sizeof(type));
+
+            std::string value = hll->serialize();
             size_t value_size = value.size();
             ofs.write(reinterpret_cast<const char *>(&value_size), sizeof(value_size));
             ofs.write(value.data(), value_size);
         }
+        else if (auto *block = std::get_if<compression::Block>(stored))
+        {
+            char type = 3; // type 3 for a compressed string
+            ofs.write(&type, sizeof(type));
+
+            char codec = static_cast<char>(block->codec);
+            ofs.write(&codec, sizeof(codec));
+            ofs.write(reinterpret_cast<const char *>(&block->size), sizeof(block->size));
+            size_t value_size = block->data.size();
+            ofs.write(reinterpret_cast<const char *>(&value_size), sizeof(value_size));
+            ofs.write(block->data.data(), value_size);
+        }
+        else if (auto *list = std::get_if<std::list<compression::Packed>>(stored))
+        {
+            char type = 1; // type 1 for list
+            ofs.write(&type, sizeof(type));
+
+            size_t list_size = list->size();
+            ofs.write(reinterpret_cast<const char *>(&list_size), sizeof(list_size));
+            for (const auto &element : *list)
+            {
+                // codec 0 for an element stored plain
+                auto *block = std::get_if<compression::Block>(&element);
+                char codec = block ? static_cast<char>(block->codec) : 0;
+                ofs.write(&codec, sizeof(codec));
+                if (block)
+                {
+                    ofs.write(reinterpret_cast<const char *>(&block->size), sizeof(block->size));
+                }
+                const std::string &value = block ? block->data : std::get<std::string>(element);
+                size_t value_size = value.size();
+                ofs.write(reinterpret_cast<const char *>(&value_size), sizeof(value_size));
+                ofs.write(value.data(), value_size);
+            }
+        }
 
         bool has_expiry = entry.expiry.has_value();
         ofs.write(reinterpret_cast<const char *>(&has_expiry), sizeof(has_expiry));
@@ -215,7 +893,7 @@ bool DataStore::save(const std::string &filename)
 
 bool DataStore::load(const std::string &filename)
 {
-    std::lock_guard<std::mutex> lock(m_store_mutex);
+    auto lock = lock_store();
     std::ifstream ifs(filename, std::ios::binary);
 
     if (!ifs)
@@ -224,6 +902,14 @@ bool DataStore::load(const std::string &filename)
     }
 
     m_store.clear();
+    m_index.clear();
+    m_key_stats.clear_sizes();
+    if (m_value_log)
+    {
+        m_value_log->clear();
+        m_spilled_keys = 0;
+        m_spilled_bytes = 0;
+    }
 
     size_t store_size;
 
@@ -245,7 +931,74 @@ bool DataStore::load(const std::string &filename)
             ifs.read(reinterpret_cast<char *>(&value_size), sizeof(value_size));
             std::string value(value_size, '\0');
             ifs.read(&value[0], value_size);
-            entry.value = value;
+            entry.value = pack_string(value);
+        }
+        else if (type == 1) // List
+        {
+            size_t list_size;
+            ifs.read(reinterpret_cast<char *>(&list_size), sizeof(list_size));
+            std::list<compression::Packed> list;
+            for (size_t j = 0; j < list_size && ifs; j++)
+            {
+                char codec;
+                ifs.read(&codec, sizeof(codec));
+                uint64_t uncompressed_size = 0;
+                if (codec != 0)
+                {
+                    ifs.read(reinterpret_cast<char *>(&uncompressed_size), sizeof(uncompressed_size));
+                }
+                size_t value_size;
+                ifs.read(reinterpret_cast<char *>(&value_size), sizeof(value_size));
+                std::string value(value_size, '\0');
+                ifs.read(value.data(), value_size);
+                if (codec == 0)
+                {
+                    list.push_back(pack(value));
+                }
+                else
+                {
+                    compression::Block block{static_cast<compression::Codec>(codec), uncompressed_size,
+                                             std::move(value)};
+                    if (!compression::is_valid(block))
+                    {
+                        return false;
+                    }
+                    list.push_back(std::move(block));
+                }
+            }
+            entry.value = std::move(list);
+        }
+        else if (type == 2) // HyperLogLog
+        {
+            size_t value_size;
+            ifs.read(reinterpret_cast<char *>(&value_size), sizeof(value_size));
+            std::string value(value_size, '\0');
+            ifs.read(&value[0], value_size);
+            try
+            {
+                entry.value = HyperLogLog::deserialize(value);
+            }
+            catch (const std::exception &)
+            {
+                return false;
+            }
+        }
+        else if (type == 3) // compressed string
+        {
+            char codec;
+            ifs.read(&codec, sizeof(codec));
+            compression::Block block{static_cast<compression::Codec>(codec), 0, {}};
+            ifs.read(reinterpret_cast<char *>(&block.size), sizeof(block.size));
+            size_t value_size;
+            ifs.read(reinterpret_cast<char *>(&value_size), sizeof(value_size));
+            block.data.resize(value_size);
+            ifs.read(&block.data[0], value_size);
+            // caught here rather than on a later read
+            if (!compression::is_valid(block))
+            {
+                return false;
+            }
+            entry.value = std::move(block);
         }
 
         bool has_expiry;
@@ -257,7 +1010,9 @@ bool DataStore::load(const std::string &filename)
             entry.expiry = std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(expiry_time_count));
         }
 
+        track_size(key, entry);
         m_store[key] = std::move(entry);
+        index_update(key, true);
     }
     return true;
 }
@@ -270,3 +1025,443 @@ bool DataStore::is_expired_entry(const ValueEntry &entry) const
     }
     return std::chrono::steady_clock::now() > entry.expiry.value();
 }
+
+void DataStore::set_key_listener(KeyListener listener)
+{
+    auto lock = lock_store();
+    m_key_listener = std::move(listener);
+}
+
+void DataStore::notify_modified(const std::string &key)
+{
+    index_update(key);
+    if (m_key_listener)
+    {
+        m_key_listener(key);
+    }
+}
+
+void DataStore::set_flush_listener(std::function<void()> listener)
+{
+    auto lock = lock_store();
+    m_flush_listener = std::move(listener);
+}
+
+void DataStore::set_lazyfree_threshold(size_t threshold)
+{
+    auto lock = lock_store();
+    m_lazyfree_threshold = threshold;
+}
+
+LazyFree::Stats DataStore::lazyfree_stats() const
+{
+    return m_lazy_free.stats();
+}
+
+std::vector<KeyStats::HotKey> DataStore::hot_keys(size_t count)
+{
+    return m_key_stats.hot_keys(count);
+}
+
+std::vector<KeyStats::BigKey> DataStore::big_keys(size_t count)
+{
+    auto lock = lock_store();
+    return m_key_stats.big_keys(count);
+}
+
+void DataStore::dispose(ValueEntry::ValueType value, size_t threshold)
+{
+    if (auto *location = std::get_if<ValueLog::Location>(&value))
+    {
+        m_value_log->release(*location);
+        m_spilled_keys--;
+        m_spilled_bytes -= location->length;
+    }
+    else if (free_effort(value) > threshold)
+    {
+        size_t bytes = estimate_bytes(value);
+        m_lazy_free.free_later(std::move(value), bytes);
+    }
+    // otherwise `value` is destroyed right here
+}
+
+bool DataStore::remove(const std::string &key, size_t lazyfree_threshold)
+{
+    auto it = m_store.find(key);
+    if (it == m_store.end())
+    {
+        return false;
+    }
+    dispose(std::move(it->second.value), lazyfree_threshold);
+    m_store.erase(it);
+    m_key_stats.record_removal(key);
+    notify_modified(key);
+    return true;
+}
+
+std::optional<std::string> DataStore::pop(const std::string &key, bool front)
+{
+    m_key_stats.record_access(key);
+    auto it = m_store.find(key);
+    if (it == m_store.end())
+    {
+        return std::nullopt;
+    }
+    if (is_expired_entry(it->second))
+    {
+        remove(key, m_lazyfree_threshold);
+        return std::nullopt;
+    }
+
+    touch(it->second);
+    auto *list = std::get_if<std::list<compression::Packed>>(&it->second.value);
+    if (!list)
+    {
+        return std::nullopt;
+    }
+    auto &element = front ? list->front() : list->back();
+    auto *plain = std::get_if<std::string>(&element);
+    std::string value = plain ? std::move(*plain) : unpack(element);
+    if (front)
+    {
+        list->pop_front();
+    }
+    else
+    {
+        list->pop_back();
+    }
+
+    if (list->empty())
+    {
+        remove(key, m_lazyfree_threshold);
+    }
+    else
+    {
+        track_size(key, it->second);
+        notify_modified(key);
+    }
+    return value;
+}
+
+void DataStore::track_size(const std::string &key, const ValueEntry &entry)
+{
+    if (auto *str = string_value(entry.value))
+    {
+        m_key_stats.record_size(key, "string", str->size());
+    }
+    else if (auto *list = std::get_if<std::list<compression::Packed>>(&entry.value))
+    {
+        m_key_stats.record_size(key, "list", list->size());
+    }
+    else if (auto *hll = std::get_if<HyperLogLog>(&entry.value))
+    {
+        m_key_stats.record_size(key, "hyperloglog", hll->bytes());
+    }
+    else if (auto *block = std::get_if<compression::Block>(&entry.value))
+    {
+        m_key_stats.record_size(key, "string", block->size);
+    }
+}
+
+HyperLogLog *DataStore::find_hyperloglog(const std::string &key)
+{
+    auto it = m_store.find(key);
+    if (it == m_store.end())
+    {
+        return nullptr;
+    }
+    if (is_expired_entry(it->second))
+    {
+        remove(key, m_lazyfree_threshold);
+        return nullptr;
+    }
+    touch(it->second);
+    auto *hll = std::get_if<HyperLogLog>(&it->second.value);
+    if (!hll)
+    {
+        throw std::runtime_error(kWrongTypeHyperLogLog);
+    }
+    return hll;
+}
+
+void DataStore::set_compression_threshold(size_t threshold)
+{
+    auto lock = lock_store();
+    m_compression_threshold = threshold;
+}
+
+DataStore::CompressionStats DataStore::compression_stats()
+{
+    auto lock = lock_store();
+    CompressionStats stats = m_compression_stats;
+    stats.threshold = m_compression_threshold;
+    return stats;
+}
+
+DataStore::ValueEntry::ValueType DataStore::pack_string(const std::string &value)
+{
+    return std::visit([](auto &&packed) -> ValueEntry::ValueType
+                      { return std::move(packed); },
+                      pack(value));
+}
+
+compression::Packed DataStore::pack(const std::string &value)
+{
+    if (m_compression_threshold == 0 || value.size() < m_compression_threshold)
+    {
+        return value;
+    }
+    auto start = std::chrono::steady_clock::now();
+    auto block = compression::compress(value);
+    m_compression_stats.compress_time += std::chrono::steady_clock::now() - start;
+    if (!block)
+    {
+        m_compression_stats.incompressible++;
+        return value;
+    }
+    m_compression_stats.compressed++;
+    m_compression_stats.input_bytes += value.size();
+    m_compression_stats.output_bytes += block->data.size();
+    return std::move(*block);
+}
+
+std::string DataStore::unpack(const compression::Packed &value)
+{
+    if (auto *block = std::get_if<compression::Block>(&value))
+    {
+        return unpack_string(*block);
+    }
+    return std::get<std::string>(value);
+}
+
+std::string DataStore::unpack_string(const compression::Block &block)
+{
+    auto start = std::chrono::steady_clock::now();
+    std::string value = compression::decompress(block);
+    m_compression_stats.decompress_time += std::chrono::steady_clock::now() - start;
+    m_compression_stats.decompressed++;
+    return value;
+}
+
+void DataStore::inflate(ValueEntry &entry)
+{
+    if (auto *block = std::get_if<compression::Block>(&entry.value))
+    {
+        entry.value = unpack_string(*block);
+    }
+}
+
+void DataStore::index_update(const std::string &key, bool share)
+{
+    if (m_single_threaded)
+    {
+        return;
+    }
+    auto it = m_store.find(key);
+    if (it == m_store.end())
+    {
+        m_index.erase(key);
+        return;
+    }
+    publish(key, it->second, share);
+}
+
+void DataStore::publish(const std::string &key, ValueEntry &entry, bool share)
+{
+    if (auto *str = std::get_if<std::string>(&entry.value); str && share)
+    {
+        entry.value = PublishedString{new std::string(std::move(*str))};
+    }
+    auto *published = std::get_if<PublishedString>(&entry.value);
+    const std::string *value = published ? published->value : nullptr;
+    const ReadIndex::Node *node = m_index.find(key);
+    if (node && node->value == value && node->expiry == entry.expiry)
+    {
+        return;
+    }
+    m_index.insert(key, value, entry.expiry, entry.last_access);
+}
+
+const std::string *DataStore::read_string(const std::string &key, std::string &unpacked)
+{
+    auto it = m_store.find(key);
+    if (it == m_store.end())
+    {
+        return nullptr;
+    }
+    if (is_expired_entry(it->second))
+    {
+        remove(key, m_lazyfree_threshold);
+        return nullptr;
+    }
+    touch(it->second);
+    if (auto *block = std::get_if<compression::Block>(&it->second.value))
+    {
+        unpacked = unpack_string(*block);
+        return &unpacked;
+    }
+    const std::string *str = string_value(it->second.value);
+    if (!str)
+    {
+        throw std::runtime_error(kWrongType);
+    }
+    return str;
+}
+
+std::string *DataStore::find_string(const std::string &key)
+{
+    std::string unpacked;
+    if (!read_string(key, unpacked))
+    {
+        return nullptr;
+    }
+    auto &entry = m_store.find(key)->second;
+    if (std::holds_alternative<compression::Block>(entry.value))
+    {
+        // modified in place from now on, so it stays decompressed
+        entry.value = std::move(unpacked);
+    }
+    else if (auto *published = std::get_if<PublishedString>(&entry.value))
+    {
+        // readers may still hold the published string: modify a copy
+        entry.value = std::string(*published->value);
+        index_update(key);
+    }
+    return &std::get<std::string>(entry.value);
+}
+
+void DataStore::touch(ValueEntry &entry)
+{
+    entry.last_access = m_access_clock;
+    if (auto *location = std::get_if<ValueLog::Location>(&entry.value))
+    {
+        ValueLog::Location spilled = *location;
+        entry.value = decode_value<ValueEntry::ValueType>(m_value_log->read(spilled));
+        m_value_log->release(spilled);
+        m_spilled_keys--;
+        m_spilled_bytes -= spilled.length;
+    }
+}
+
+void DataStore::enable_tiering(TieringOptions options)
+{
+    auto lock = lock_store();
+    m_value_log = std::make_unique<ValueLog>(options.directory);
+    m_tiering = std::move(options);
+    m_tiering_epoch = std::chrono::steady_clock::now();
+}
+
+void DataStore::run_tiering()
+{
+    auto lock = lock_store();
+    if (!m_value_log)
+    {
+        return;
+    }
+    auto now = std::chrono::steady_clock::now();
+    m_access_clock = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::seconds>(now - m_tiering_epoch).count());
+
+    for (auto &relocation : m_value_log->take_relocations())
+    {
+        auto it = m_store.find(relocation.key);
+        auto *location = it == m_store.end() ? nullptr : std::get_if<ValueLog::Location>(&it->second.value);
+        if (location && *location == relocation.from)
+        {
+            *location = relocation.to;
+        }
+        else
+        {
+            // overwritten or deleted while being compacted
+            m_value_log->release(relocation.to);
+        }
+    }
+
+    // Walk the table a few buckets at a time; a rehash merely makes the
+    // cursor skip or revisit some entries.
+    uint32_t cold_after = static_cast<uint32_t>(m_tiering.cold_after.count());
+    size_t examined = 0;
+    for (size_t visited = 0; visited < m_tiering.scan_budget && examined < m_tiering.scan_budget && !m_store.empty(); visited++)
+    {
+        if (m_tiering_cursor >= m_store.bucket_count())
+        {
+            m_tiering_cursor = 0;
+        }
+        for (auto it = m_store.begin(m_tiering_cursor); it != m_store.end(m_tiering_cursor); ++it)
+        {
+            examined++;
+            auto &entry = it->second;
+            uint32_t last_access = entry.last_access;
+            if (std::holds_alternative<PublishedString>(entry.value))
+            {
+                // lock-free reads leave their mark on the index node
+                if (const ReadIndex::Node *node = m_index.find(it->first))
+                {
+                    last_access = std::max(last_access, node->last_access.load(std::memory_order_relaxed));
+                }
+            }
+            if (std::holds_alternative<ValueLog::Location>(entry.value) ||
+                m_access_clock - last_access < cold_after ||
+                is_expired_entry(entry) ||
+                estimate_bytes(entry.value) < m_tiering.min_value_bytes)
+            {
+                continue;
+            }
+            try
+            {
+                std::string encoded = encode_value(entry.value);
+                auto location = m_value_log->append(it->first, encoded);
+                dispose(std::exchange(entry.value, location), m_lazyfree_threshold);
+                index_update(it->first);
+                m_spilled_keys++;
+                m_spilled_bytes += location.length;
+            }
+            catch (const std::exception &)
+            {
+                // out of disk: keep the value in memory
+                return;
+            }
+        }
+        m_tiering_cursor++;
+    }
+}
+
+DataStore::TieringStats DataStore::tiering_stats()
+{
+    auto lock = lock_store();
+    return TieringStats{m_spilled_keys, m_spilled_bytes, m_value_log ? m_value_log->stats() : ValueLog::Stats{}};
+}
+
+void DataStore::set_single_threaded(bool single_threaded)
+{
+    if (single_threaded == m_single_threaded)
+    {
+        return;
+    }
+    m_single_threaded = single_threaded;
+    // No reader can be active while the mode changes, so published strings
+    // move in and out of the index without copies.
+    for (auto &[key, entry] : m_store)
+    {
+        if (!single_threaded)
+        {
+            publish(key, entry, true);
+        }
+        else if (auto *published = std::get_if<PublishedString>(&entry.value))
+        {
+            entry.value = std::move(*published->value);
+        }
+    }
+    if (single_threaded)
+    {
+        m_index.clear();
+    }
+}
+
+std::unique_lock<std::mutex> DataStore::lock_store()
+{
+    if (m_single_threaded)
+    {
+        return std::unique_lock<std::mutex>();
+    }
+    return std::unique_lock<std::mutex>(m_store_mutex);
+}
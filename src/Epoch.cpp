@@ -0,0 +1,173 @@
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <mutex>
+#include <vector>
+
+#include "Epoch.hpp"
+
+namespace epoch
+{
+    namespace
+    {
+        constexpr uint64_t kIdle = std::numeric_limits<uint64_t>::max();
+        constexpr size_t kCollectInterval = 64;
+    }
+
+    // One per thread, in its own cache line so that pinning does not bounce
+    // lines between readers.
+    struct alignas(64) Participant
+    {
+        std::atomic<uint64_t> epoch{kIdle};
+        unsigned depth{0};
+    };
+
+    namespace
+    {
+        struct Retired
+        {
+            void *object;
+            void (*deleter)(void *);
+            uint64_t epoch;
+        };
+
+        struct Domain
+        {
+            std::atomic<uint64_t> global{0};
+            std::mutex mutex;
+            std::vector<Participant *> participants;
+            std::vector<Retired> retired;
+            size_t collect_at{kCollectInterval};
+        };
+
+        // Never destroyed: threads may still retire objects during static
+        // destruction, and whatever is pending at exit goes with the process.
+        Domain &domain()
+        {
+            static Domain *instance = new Domain;
+            return *instance;
+        }
+
+        struct Registration
+        {
+            Participant *participant = new Participant;
+
+            Registration()
+            {
+                auto &d = domain();
+                std::lock_guard<std::mutex> lock(d.mutex);
+                d.participants.push_back(participant);
+            }
+
+            ~Registration()
+            {
+                auto &d = domain();
+                std::lock_guard<std::mutex> lock(d.mutex);
+                d.participants.erase(std::find(d.participants.begin(), d.participants.end(), participant));
+                delete participant;
+            }
+        };
+
+        Participant &self()
+        {
+            thread_local Registration registration;
+            return *registration.participant;
+        }
+
+        // Called with the domain mutex held; returns what can be freed.
+        std::vector<Retired> collect_locked(Domain &d)
+        {
+            uint64_t current = d.global.load();
+            bool caught_up = std::all_of(d.participants.begin(), d.participants.end(), [&](Participant *p)
+                                         {
+                                             uint64_t epoch = p->epoch.load();
+                                             return epoch == kIdle || epoch == current; });
+            if (caught_up)
+            {
+                d.global.store(++current);
+            }
+
+            // A guard pins the epoch it observed, and the global epoch moves
+            // at most one past the oldest pin; two epochs on, no guard can be
+            // left that saw the object before it was unlinked.
+            std::vector<Retired> ready;
+            auto still_reachable = std::partition(d.retired.begin(), d.retired.end(), [&](const Retired &r)
+                                                  { return r.epoch + 2 > current; });
+            ready.assign(still_reachable, d.retired.end());
+            d.retired.erase(still_reachable, d.retired.end());
+            d.collect_at = std::max(kCollectInterval, d.retired.size() * 2);
+            return ready;
+        }
+
+        void free_all(const std::vector<Retired> &ready)
+        {
+            for (const auto &r : ready)
+            {
+                r.deleter(r.object);
+            }
+        }
+    }
+
+    Guard::Guard() : m_participant(&self())
+    {
+        if (m_participant->depth++ > 0)
+        {
+            return;
+        }
+        // Publish the pin, then make sure the epoch did not move before it
+        // became visible; otherwise collect() may not have seen it.
+        auto &d = domain();
+        uint64_t observed = d.global.load();
+        while (true)
+        {
+            m_participant->epoch.store(observed);
+            uint64_t now = d.global.load();
+            if (now == observed)
+            {
+                break;
+            }
+            observed = now;
+        }
+    }
+
+    Guard::~Guard()
+    {
+        if (--m_participant->depth == 0)
+        {
+            m_participant->epoch.store(kIdle, std::memory_order_release);
+        }
+    }
+
+    void retire(void *object, void (*deleter)(void *))
+    {
+        auto &d = domain();
+        std::vector<Retired> ready;
+        {
+            std::lock_guard<std::mutex> lock(d.mutex);
+            d.retired.push_back({object, deleter, d.global.load()});
+            if (d.retired.size() >= d.collect_at)
+            {
+                ready = collect_locked(d);
+            }
+        }
+        free_all(ready);
+    }
+
+    void collect()
+    {
+        auto &d = domain();
+        std::vector<Retired> ready;
+        {
+            std::lock_guard<std::mutex> lock(d.mutex);
+            ready = collect_locked(d);
+        }
+        free_all(ready);
+    }
+
+    size_t pending()
+    {
+        auto &d = domain();
+        std::lock_guard<std::mutex> lock(d.mutex);
+        return d.retired.size();
+    }
+}
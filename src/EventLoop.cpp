@@ -0,0 +1,303 @@
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include "EventLoop.hpp"
+
+namespace
+{
+    constexpr size_t kFrameGranularity = 64;
+    constexpr size_t kMaxPooledFrame = 8192;
+    // Bounds the memory kept after a burst of connections has gone away.
+    constexpr size_t kMaxFramesPerClass = 4096;
+
+    struct FreeLists
+    {
+        std::vector<std::vector<void *>> lists = std::vector<std::vector<void *>>(kMaxPooledFrame / kFrameGranularity);
+
+        ~FreeLists()
+        {
+            for (auto &list : lists)
+            {
+                for (void *frame : list)
+                {
+                    ::operator delete(frame);
+                }
+            }
+        }
+    };
+
+    thread_local FreeLists t_free_lists;
+
+    size_t size_class(size_t size)
+    {
+        return (size - 1) / kFrameGranularity;
+    }
+}
+
+void *FramePool::allocate(size_t size)
+{
+    if (size == 0 || size > kMaxPooledFrame)
+    {
+        return ::operator new(size);
+    }
+    auto &list = t_free_lists.lists[size_class(size)];
+    if (list.empty())
+    {
+        // round up so any frame of the class fits when recycled
+        return ::operator new((size_class(size) + 1) * kFrameGranularity);
+    }
+    void *frame = list.back();
+    list.pop_back();
+    return frame;
+}
+
+void FramePool::deallocate(void *frame, size_t size)
+{
+    if (size == 0 || size > kMaxPooledFrame)
+    {
+        ::operator delete(frame);
+        return;
+    }
+    auto &list = t_free_lists.lists[size_class(size)];
+    if (list.size() >= kMaxFramesPerClass)
+    {
+        ::operator delete(frame);
+        return;
+    }
+    list.push_back(frame);
+}
+
+size_t FramePool::cached_frames()
+{
+    size_t count = 0;
+    for (const auto &list : t_free_lists.lists)
+    {
+        count += list.size();
+    }
+    return count;
+}
+
+void Task::promise_type::unhandled_exception()
+{
+    try
+    {
+        throw;
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Coroutine failed: " << e.what() << std::endl;
+    }
+    catch (...)
+    {
+        std::cerr << "Coroutine failed" << std::endl;
+    }
+}
+
+EventLoop::EventLoop()
+{
+    m_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (m_epoll_fd < 0)
+    {
+        throw std::runtime_error("Failed to create epoll instance");
+    }
+}
+
+EventLoop::~EventLoop()
+{
+    close(m_epoll_fd);
+}
+
+void EventLoop::watch(int fd)
+{
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    event.data.fd = fd;
+    if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0)
+    {
+        throw std::runtime_error("Failed to watch fd");
+    }
+    m_watches[fd] = Watch{};
+}
+
+void EventLoop::unwatch(int fd)
+{
+    epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    m_watches.erase(fd);
+}
+
+bool EventLoop::IoWait::await_ready()
+{
+    auto &watch = m_loop.m_watches.at(m_fd);
+    if (watch.ready & m_events)
+    {
+        watch.ready &= ~m_events;
+        return true;
+    }
+    return false;
+}
+
+void EventLoop::IoWait::await_suspend(std::coroutine_handle<> handle)
+{
+    auto &watch = m_loop.m_watches.at(m_fd);
+    watch.waiter = handle;
+    watch.waiting_for = m_events;
+}
+
+void EventLoop::Sleep::await_suspend(std::coroutine_handle<> handle)
+{
+    EventLoop &loop = m_loop;
+    loop.add_timer(Clock::now() + m_duration, [&loop, handle]
+                   { loop.post(handle); });
+}
+
+void EventLoop::wake(int fd)
+{
+    auto it = m_watches.find(fd);
+    if (it != m_watches.end() && it->second.waiter)
+    {
+        ready(it->second, it->second.waiting_for);
+    }
+}
+
+void EventLoop::on_readable(int fd, std::function<void()> callback)
+{
+    auto &watch = m_watches.at(fd);
+    if (watch.ready & kReadable)
+    {
+        watch.ready &= ~kReadable;
+        callback();
+        return;
+    }
+    watch.on_readable = std::move(callback);
+}
+
+void EventLoop::cancel_on_readable(int fd)
+{
+    auto it = m_watches.find(fd);
+    if (it != m_watches.end())
+    {
+        it->second.on_readable = nullptr;
+    }
+}
+
+void EventLoop::on_writable(int fd, std::function<void()> callback)
+{
+    auto &watch = m_watches.at(fd);
+    if (watch.ready & kWritable)
+    {
+        watch.ready &= ~kWritable;
+        callback();
+        return;
+    }
+    watch.on_writable = std::move(callback);
+}
+
+void EventLoop::cancel_on_writable(int fd)
+{
+    auto it = m_watches.find(fd);
+    if (it != m_watches.end())
+    {
+        it->second.on_writable = nullptr;
+    }
+}
+
+void EventLoop::post(std::coroutine_handle<> handle)
+{
+    m_ready.push_back(handle);
+}
+
+EventLoop::TimerId EventLoop::add_timer(Clock::time_point when, std::function<void()> callback)
+{
+    return m_timers.emplace(when, std::move(callback));
+}
+
+void EventLoop::cancel_timer(TimerId timer)
+{
+    m_timers.erase(timer);
+}
+
+void EventLoop::ready(Watch &watch, uint32_t events)
+{
+    // Callbacks may register themselves again but never unwatch the fd.
+    if (watch.on_writable && (events & kWritable))
+    {
+        auto callback = std::move(watch.on_writable);
+        watch.on_writable = nullptr;
+        events &= ~kWritable;
+        callback();
+    }
+    if (watch.on_readable && (events & kReadable))
+    {
+        auto callback = std::move(watch.on_readable);
+        watch.on_readable = nullptr;
+        events &= ~kReadable;
+        callback();
+    }
+    if (watch.waiter && (events & watch.waiting_for))
+    {
+        m_ready.push_back(watch.waiter);
+        watch.waiter = nullptr;
+        watch.ready |= events & ~watch.waiting_for;
+        watch.waiting_for = 0;
+    }
+    else
+    {
+        watch.ready |= events;
+    }
+}
+
+void EventLoop::run_once(std::chrono::milliseconds max_wait)
+{
+    auto now = Clock::now();
+    int timeout = static_cast<int>(max_wait.count());
+    if (!m_ready.empty())
+    {
+        timeout = 0;
+    }
+    else if (!m_timers.empty())
+    {
+        auto until_timer = std::chrono::ceil<std::chrono::milliseconds>(m_timers.begin()->first - now);
+        timeout = static_cast<int>(std::max<int64_t>(0, std::min<int64_t>(timeout, until_timer.count())));
+    }
+
+    epoll_event events[256];
+    int n = epoll_wait(m_epoll_fd, events, 256, timeout);
+    for (int i = 0; i < n; i++)
+    {
+        auto it = m_watches.find(events[i].data.fd);
+        if (it == m_watches.end())
+        {
+            continue;
+        }
+        uint32_t ready_events = 0;
+        // errors and hangups wake readers and writers alike; their next call fails
+        if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+        {
+            ready_events |= kReadable;
+        }
+        if (events[i].events & (EPOLLOUT | EPOLLHUP | EPOLLERR))
+        {
+            ready_events |= kWritable;
+        }
+        ready(it->second, ready_events);
+    }
+
+    now = Clock::now();
+    while (!m_timers.empty() && m_timers.begin()->first <= now)
+    {
+        auto callback = std::move(m_timers.begin()->second);
+        m_timers.erase(m_timers.begin());
+        callback();
+    }
+
+    // Only what was ready on entry; coroutines posted meanwhile run next time.
+    for (size_t count = m_ready.size(); count > 0; count--)
+    {
+        auto handle = m_ready.front();
+        m_ready.pop_front();
+        handle.resume();
+    }
+}
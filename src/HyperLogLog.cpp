@@ -0,0 +1,402 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#include "HyperLogLog.hpp"
+#include "CpuFeatures.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HLL_X86 1
+#endif
+
+namespace
+{
+    constexpr int kHashBits = 64 - HyperLogLog::kPrecision;
+    constexpr uint8_t kRegisterMask = (1 << HyperLogLog::kRegisterBits) - 1;
+    constexpr char kSparseTag = 'S';
+    constexpr char kDenseTag = 'D';
+
+    uint64_t murmur_hash64a(const char *key, size_t length, uint64_t seed)
+    {
+        const uint64_t m = 0xc6a4a7935bd1e995ULL;
+        const int r = 47;
+        uint64_t h = seed ^ (length * m);
+
+        const char *end = key + (length & ~size_t{7});
+        for (; key != end; key += 8)
+        {
+            uint64_t k;
+            std::memcpy(&k, key, sizeof(k));
+            k *= m;
+            k ^= k >> r;
+            k *= m;
+            h ^= k;
+            h *= m;
+        }
+
+        const auto *tail = reinterpret_cast<const uint8_t *>(key);
+        switch (length & 7)
+        {
+        case 7:
+            h ^= uint64_t{tail[6]} << 48;
+            [[fallthrough]];
+        case 6:
+            h ^= uint64_t{tail[5]} << 40;
+            [[fallthrough]];
+        case 5:
+            h ^= uint64_t{tail[4]} << 32;
+            [[fallthrough]];
+        case 4:
+            h ^= uint64_t{tail[3]} << 24;
+            [[fallthrough]];
+        case 3:
+            h ^= uint64_t{tail[2]} << 16;
+            [[fallthrough]];
+        case 2:
+            h ^= uint64_t{tail[1]} << 8;
+            [[fallthrough]];
+        case 1:
+            h ^= uint64_t{tail[0]};
+            h *= m;
+        }
+
+        h ^= h >> r;
+        h *= m;
+        h ^= h >> r;
+        return h;
+    }
+
+    // Helpers of Ertl's improved estimator ("New cardinality estimation
+    // algorithms for HyperLogLog sketches", 2017), which works from the
+    // register histogram and needs no bias tables or range corrections.
+    double sigma(double x)
+    {
+        if (x == 1.0)
+        {
+            return INFINITY;
+        }
+        double y = 1.0;
+        double z = x;
+        double previous;
+        do
+        {
+            x *= x;
+            previous = z;
+            z += x * y;
+            y += y;
+        } while (previous != z);
+        return z;
+    }
+
+    double tau(double x)
+    {
+        if (x == 0.0 || x == 1.0)
+        {
+            return 0.0;
+        }
+        double y = 1.0;
+        double z = 1.0 - x;
+        double previous;
+        do
+        {
+            x = std::sqrt(x);
+            previous = z;
+            y *= 0.5;
+            z -= std::pow(1.0 - x, 2) * y;
+        } while (previous != z);
+        return z / 3.0;
+    }
+
+    uint64_t estimate(const uint32_t (&histogram)[kHashBits + 2])
+    {
+        const double m = static_cast<double>(HyperLogLog::kRegisters);
+        double z = m * tau((m - histogram[kHashBits + 1]) / m);
+        for (int j = kHashBits; j >= 1; j--)
+        {
+            z += histogram[j];
+            z *= 0.5;
+        }
+        z += m * sigma(histogram[0] / m);
+        constexpr double kAlphaInf = 0.721347520444481703680;
+        return static_cast<uint64_t>(std::llround(kAlphaInf * m * m / z));
+    }
+}
+
+bool HyperLogLog::add(std::string_view element)
+{
+    uint64_t hash = murmur_hash64a(element.data(), element.size(), 0xadc83b19ULL);
+    uint32_t index = static_cast<uint32_t>(hash & (kRegisters - 1));
+    // The sentinel bit caps the run of zeros at kHashBits.
+    uint64_t bits = (hash >> kPrecision) | (uint64_t{1} << kHashBits);
+    uint8_t value = static_cast<uint8_t>(__builtin_ctzll(bits) + 1);
+
+    if (is_sparse())
+    {
+        auto it = std::lower_bound(m_sparse.begin(), m_sparse.end(), sparse_entry(index, 0));
+        if (it != m_sparse.end() && (*it >> 8) == index)
+        {
+            if ((*it & 0xff) >= value)
+            {
+                return false;
+            }
+            *it = sparse_entry(index, value);
+        }
+        else
+        {
+            m_sparse.insert(it, sparse_entry(index, value));
+            if (m_sparse.size() * sizeof(uint32_t) > kSparseMaxBytes)
+            {
+                promote();
+            }
+        }
+    }
+    else
+    {
+        if (get_dense(index) >= value)
+        {
+            return false;
+        }
+        set_dense(index, value);
+    }
+    m_cached_count.reset();
+    return true;
+}
+
+uint64_t HyperLogLog::count() const
+{
+    if (m_cached_count)
+    {
+        return *m_cached_count;
+    }
+
+    uint32_t histogram[kHashBits + 2] = {};
+    if (is_sparse())
+    {
+        histogram[0] = static_cast<uint32_t>(kRegisters - m_sparse.size());
+        for (uint32_t entry : m_sparse)
+        {
+            histogram[entry & 0xff]++;
+        }
+    }
+    else
+    {
+        uint8_t registers[kRegisters];
+        unpack(registers);
+        // Four partial histograms keep consecutive increments independent.
+        uint32_t partial[4][kHashBits + 2] = {};
+        for (size_t i = 0; i < kRegisters; i += 4)
+        {
+            partial[0][registers[i]]++;
+            partial[1][registers[i + 1]]++;
+            partial[2][registers[i + 2]]++;
+            partial[3][registers[i + 3]]++;
+        }
+        for (int j = 0; j < kHashBits + 2; j++)
+        {
+            histogram[j] = partial[0][j] + partial[1][j] + partial[2][j] + partial[3][j];
+        }
+    }
+
+    m_cached_count = estimate(histogram);
+    return *m_cached_count;
+}
+
+void HyperLogLog::merge(const HyperLogLog &other)
+{
+    if (is_sparse() && other.is_sparse())
+    {
+        std::vector<uint32_t> merged;
+        merged.reserve(m_sparse.size() + other.m_sparse.size());
+        auto a = m_sparse.begin();
+        auto b = other.m_sparse.begin();
+        while (a != m_sparse.end() || b != other.m_sparse.end())
+        {
+            if (b == other.m_sparse.end() || (a != m_sparse.end() && (*a >> 8) < (*b >> 8)))
+            {
+                merged.push_back(*a++);
+            }
+            else if (a == m_sparse.end() || (*b >> 8) < (*a >> 8))
+            {
+                merged.push_back(*b++);
+            }
+            else
+            {
+                merged.push_back(std::max(*a++, *b++));
+            }
+        }
+        m_sparse = std::move(merged);
+        if (m_sparse.size() * sizeof(uint32_t) > kSparseMaxBytes)
+        {
+            promote();
+        }
+    }
+    else
+    {
+        uint8_t registers[kRegisters];
+        uint8_t other_registers[kRegisters];
+        unpack(registers);
+        other.unpack(other_registers);
+        max_registers(registers, other_registers, kRegisters);
+        pack(registers);
+    }
+    m_cached_count.reset();
+}
+
+size_t HyperLogLog::bytes() const
+{
+    return is_sparse() ? m_sparse.capacity() * sizeof(uint32_t) : m_dense.size();
+}
+
+std::string HyperLogLog::serialize() const
+{
+    std::string out;
+    if (is_sparse())
+    {
+        out.resize(1 + m_sparse.size() * sizeof(uint32_t));
+        out[0] = kSparseTag;
+        std::memcpy(out.data() + 1, m_sparse.data(), m_sparse.size() * sizeof(uint32_t));
+    }
+    else
+    {
+        out.resize(1 + m_dense.size());
+        out[0] = kDenseTag;
+        std::memcpy(out.data() + 1, m_dense.data(), m_dense.size());
+    }
+    return out;
+}
+
+HyperLogLog HyperLogLog::deserialize(std::string_view data)
+{
+    HyperLogLog hll;
+    if (!data.empty() && data[0] == kSparseTag && (data.size() - 1) % sizeof(uint32_t) == 0)
+    {
+        hll.m_sparse.resize((data.size() - 1) / sizeof(uint32_t));
+        std::memcpy(hll.m_sparse.data(), data.data() + 1, data.size() - 1);
+        for (size_t i = 0; i < hll.m_sparse.size(); i++)
+        {
+            uint32_t entry = hll.m_sparse[i];
+            if ((entry >> 8) >= kRegisters || (entry & 0xff) == 0 || (entry & 0xff) > kHashBits + 1 ||
+                (i > 0 && (hll.m_sparse[i - 1] >> 8) >= (entry >> 8)))
+            {
+                throw std::runtime_error("Corrupt HyperLogLog");
+            }
+        }
+        return hll;
+    }
+    if (data.size() == 1 + kDenseBytes && data[0] == kDenseTag)
+    {
+        hll.m_dense.assign(data.begin() + 1, data.end());
+        // count() indexes its histogram by register value
+        uint8_t registers[kRegisters];
+        hll.unpack(registers);
+        for (uint8_t value : registers)
+        {
+            if (value > kHashBits + 1)
+            {
+                throw std::runtime_error("Corrupt HyperLogLog");
+            }
+        }
+        return hll;
+    }
+    throw std::runtime_error("Corrupt HyperLogLog");
+}
+
+void HyperLogLog::max_registers_scalar(uint8_t *target, const uint8_t *source, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        target[i] = std::max(target[i], source[i]);
+    }
+}
+
+#ifdef HLL_X86
+__attribute__((target("avx2"))) void HyperLogLog::max_registers_avx2(uint8_t *target, const uint8_t *source, size_t count)
+{
+    size_t i = 0;
+    for (; i + 32 <= count; i += 32)
+    {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(target + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(source + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(target + i), _mm256_max_epu8(a, b));
+    }
+    max_registers_scalar(target + i, source + i, count - i);
+}
+#else
+void HyperLogLog::max_registers_avx2(uint8_t *target, const uint8_t *source, size_t count)
+{
+    max_registers_scalar(target, source, count);
+}
+#endif
+
+void HyperLogLog::max_registers(uint8_t *target, const uint8_t *source, size_t count)
+{
+    using Kernel = void (*)(uint8_t *, const uint8_t *, size_t);
+    static const Kernel kernel = cpu::has_avx2() ? max_registers_avx2 : max_registers_scalar;
+    kernel(target, source, count);
+}
+
+// Register i occupies bits [6i, 6i + 6) of the dense array, least
+// significant bit first, so four registers fill three bytes.
+
+void HyperLogLog::set_dense(size_t index, uint8_t value)
+{
+    size_t bit = index * kRegisterBits;
+    size_t byte = bit / 8;
+    unsigned shift = bit % 8;
+    uint16_t word = static_cast<uint16_t>(m_dense[byte] | m_dense[byte + 1] << 8);
+    word = static_cast<uint16_t>((word & ~(kRegisterMask << shift)) | (value << shift));
+    m_dense[byte] = static_cast<uint8_t>(word);
+    m_dense[byte + 1] = static_cast<uint8_t>(word >> 8);
+}
+
+uint8_t HyperLogLog::get_dense(size_t index) const
+{
+    size_t bit = index * kRegisterBits;
+    size_t byte = bit / 8;
+    unsigned shift = bit % 8;
+    return static_cast<uint8_t>(((m_dense[byte] | m_dense[byte + 1] << 8) >> shift) & kRegisterMask);
+}
+
+void HyperLogLog::promote()
+{
+    uint8_t registers[kRegisters];
+    unpack(registers);
+    pack(registers);
+}
+
+void HyperLogLog::unpack(uint8_t *registers) const
+{
+    if (is_sparse())
+    {
+        std::memset(registers, 0, kRegisters);
+        for (uint32_t entry : m_sparse)
+        {
+            registers[entry >> 8] = static_cast<uint8_t>(entry & 0xff);
+        }
+        return;
+    }
+    const uint8_t *in = m_dense.data();
+    for (size_t i = 0; i < kRegisters; i += 4, in += 3)
+    {
+        registers[i] = in[0] & kRegisterMask;
+        registers[i + 1] = static_cast<uint8_t>((in[0] >> 6 | in[1] << 2) & kRegisterMask);
+        registers[i + 2] = static_cast<uint8_t>((in[1] >> 4 | in[2] << 4) & kRegisterMask);
+        registers[i + 3] = in[2] >> 2;
+    }
+}
+
+void HyperLogLog::pack(const uint8_t *registers)
+{
+    m_dense.assign(kDenseBytes, 0);
+    m_sparse.clear();
+    m_sparse.shrink_to_fit();
+    uint8_t *out = m_dense.data();
+    for (size_t i = 0; i < kRegisters; i += 4, out += 3)
+    {
+        out[0] = static_cast<uint8_t>(registers[i] | registers[i + 1] << 6);
+        out[1] = static_cast<uint8_t>(registers[i + 1] >> 2 | registers[i + 2] << 4);
+        out[2] = static_cast<uint8_t>(registers[i + 2] >> 4 | registers[i + 3] << 2);
+    }
+}
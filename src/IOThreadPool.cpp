@@ -0,0 +1,85 @@
+#include "IOThreadPool.hpp"
+
+IOThreadPool::IOThreadPool(size_t threads)
+{
+    for (size_t i = 1; i < threads; i++)
+    {
+        m_workers.emplace_back(&IOThreadPool::worker, this, i);
+    }
+}
+
+IOThreadPool::~IOThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_start_cv.notify_all();
+    for (auto &thread : m_workers)
+    {
+        thread.join();
+    }
+}
+
+void IOThreadPool::run(size_t count, const std::function<void(size_t)> &task)
+{
+    // Waking workers costs more than a couple of clients' worth of I/O.
+    if (m_workers.empty() || count < 2)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            task(i);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_task = &task;
+        m_count = count;
+        m_running = m_workers.size();
+        m_generation++;
+    }
+    m_start_cv.notify_all();
+
+    run_share(0, size());
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done_cv.wait(lock, [this]
+                   { return m_running == 0; });
+    m_task = nullptr;
+}
+
+void IOThreadPool::worker(size_t index)
+{
+    uint64_t seen = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_start_cv.wait(lock, [this, seen]
+                            { return m_stop || m_generation != seen; });
+            if (m_stop)
+            {
+                return;
+            }
+            seen = m_generation;
+        }
+
+        run_share(index, size());
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (--m_running == 0)
+        {
+            m_done_cv.notify_one();
+        }
+    }
+}
+
+void IOThreadPool::run_share(size_t index, size_t stride)
+{
+    for (size_t i = index; i < m_count; i += stride)
+    {
+        (*m_task)(i);
+    }
+}
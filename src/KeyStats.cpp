@@ -0,0 +1,242 @@
+#include <algorithm>
+#include <functional>
+
+#include "KeyStats.hpp"
+
+KeyStats::KeyStats(unsigned sample_shift, size_t top_k) : m_sample_shift(sample_shift), m_top_k(top_k)
+{
+}
+
+void KeyStats::record_access(const std::string &key)
+{
+    thread_local uint32_t accesses = 0;
+    if ((++accesses & ((1u << m_sample_shift) - 1)) != 0)
+    {
+        return;
+    }
+
+    static std::atomic<size_t> next_shard{0};
+    thread_local size_t shard_index = next_shard++ % kShards;
+    Shard &shard = m_shards[shard_index];
+    uint64_t hash = std::hash<std::string>{}(key);
+    std::vector<Sample> batch;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.sampled.push_back(Sample{hash, key});
+        if (shard.sampled.size() < kBatch)
+        {
+            return;
+        }
+        batch.reserve(kBatch);
+        batch.swap(shard.sampled);
+    }
+    merge(batch);
+}
+
+void KeyStats::merge(std::vector<Sample> &sampled)
+{
+    if (sampled.empty())
+    {
+        return;
+    }
+    // hot keys repeat within a batch; count each one once
+    std::sort(sampled.begin(), sampled.end(), [](const Sample &a, const Sample &b)
+              { return a.hash < b.hash; });
+    std::vector<std::pair<const std::string *, uint32_t>> estimates;
+    for (size_t i = 0; i < sampled.size();)
+    {
+        size_t end = i + 1;
+        while (end < sampled.size() && sampled[end].hash == sampled[i].hash && sampled[end].key == sampled[i].key)
+        {
+            end++;
+        }
+        estimates.emplace_back(&sampled[i].key, increment_sketch(sampled[i].hash, static_cast<uint32_t>(end - i)));
+        i = end;
+    }
+    uint64_t before = m_samples.fetch_add(sampled.size());
+    if (before / kDecayInterval != (before + sampled.size()) / kDecayInterval)
+    {
+        decay();
+    }
+
+    std::lock_guard<std::mutex> lock(m_hot_mutex);
+    for (const auto &[key, estimate] : estimates)
+    {
+        auto it = m_hot.find(*key);
+        if (it != m_hot.end())
+        {
+            it->second = estimate;
+            continue;
+        }
+        if (m_hot.size() < m_top_k * 2)
+        {
+            m_hot.emplace(*key, estimate);
+            continue;
+        }
+        // Most sampled keys are not hot; reject them without scanning the table.
+        if (estimate <= m_hot_floor)
+        {
+            continue;
+        }
+        auto coldest = std::min_element(m_hot.begin(), m_hot.end(), [](const auto &a, const auto &b)
+                                        { return a.second < b.second; });
+        if (coldest->second < estimate)
+        {
+            m_hot.erase(coldest);
+            m_hot.emplace(*key, estimate);
+        }
+        else
+        {
+            m_hot_floor = coldest->second;
+        }
+    }
+    sampled.clear();
+}
+
+std::vector<KeyStats::HotKey> KeyStats::hot_keys(size_t count)
+{
+    for (auto &shard : m_shards)
+    {
+        std::vector<Sample> batch;
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            batch.swap(shard.sampled);
+        }
+        merge(batch);
+    }
+
+    std::vector<HotKey> result;
+    {
+        std::lock_guard<std::mutex> lock(m_hot_mutex);
+        for (const auto &[key, estimate] : m_hot)
+        {
+            result.push_back(HotKey{key, static_cast<uint64_t>(estimate) << m_sample_shift});
+        }
+    }
+    std::sort(result.begin(), result.end(), [](const HotKey &a, const HotKey &b)
+              { return a.accesses > b.accesses; });
+    result.resize(std::min(result.size(), std::min(count, m_top_k)));
+    return result;
+}
+
+void KeyStats::record_size(const std::string &key, const char *type, size_t size)
+{
+    auto current = m_big_type.find(key);
+    if (current != m_big_type.end() && current->second != type)
+    {
+        record_removal(key);
+        current = m_big_type.end();
+    }
+
+    SizeTable &table = m_big[type];
+    if (current != m_big_type.end())
+    {
+        size_t &held = table.sizes[key];
+        bool was_smallest = held == table.min_size;
+        held = size;
+        if (size < table.min_size || was_smallest)
+        {
+            update_min_size(table);
+        }
+        return;
+    }
+    if (table.sizes.size() < m_top_k)
+    {
+        table.sizes.emplace(key, size);
+        m_big_type.emplace(key, type);
+        update_min_size(table);
+        return;
+    }
+    if (size <= table.min_size)
+    {
+        return;
+    }
+
+    auto smallest = std::min_element(table.sizes.begin(), table.sizes.end(), [](const auto &a, const auto &b)
+                                     { return a.second < b.second; });
+    m_big_type.erase(smallest->first);
+    table.sizes.erase(smallest);
+    table.sizes.emplace(key, size);
+    m_big_type.emplace(key, type);
+    update_min_size(table);
+}
+
+void KeyStats::update_min_size(SizeTable &table) const
+{
+    // Until the table is full any size qualifies.
+    if (table.sizes.size() < m_top_k)
+    {
+        table.min_size = 0;
+        return;
+    }
+    table.min_size = std::min_element(table.sizes.begin(), table.sizes.end(), [](const auto &a, const auto &b)
+                                      { return a.second < b.second; })
+                         ->second;
+}
+
+void KeyStats::record_removal(const std::string &key)
+{
+    auto it = m_big_type.find(key);
+    if (it == m_big_type.end())
+    {
+        return;
+    }
+    SizeTable &table = m_big[it->second];
+    table.sizes.erase(key);
+    update_min_size(table);
+    m_big_type.erase(it);
+}
+
+void KeyStats::clear_sizes()
+{
+    m_big.clear();
+    m_big_type.clear();
+}
+
+std::vector<KeyStats::BigKey> KeyStats::big_keys(size_t count) const
+{
+    std::vector<BigKey> result;
+    for (const auto &[type, table] : m_big)
+    {
+        std::vector<BigKey> of_type;
+        for (const auto &[key, size] : table.sizes)
+        {
+            of_type.push_back(BigKey{key, type, size});
+        }
+        std::sort(of_type.begin(), of_type.end(), [](const BigKey &a, const BigKey &b)
+                  { return a.size > b.size; });
+        of_type.resize(std::min(of_type.size(), count));
+        result.insert(result.end(), of_type.begin(), of_type.end());
+    }
+    return result;
+}
+
+uint32_t KeyStats::increment_sketch(uint64_t hash, uint32_t count)
+{
+    // Derive all row indexes from one hash (Kirsch-Mitzenmacher).
+    uint32_t h1 = static_cast<uint32_t>(hash);
+    uint32_t h2 = static_cast<uint32_t>(hash >> 32) | 1;
+
+    uint32_t estimate = UINT32_MAX;
+    for (size_t row = 0; row < kDepth; row++)
+    {
+        size_t column = (h1 + row * h2) & (kWidth - 1);
+        uint32_t value = m_sketch[row * kWidth + column].fetch_add(count, std::memory_order_relaxed) + count;
+        estimate = std::min(estimate, value);
+    }
+    return estimate;
+}
+
+void KeyStats::decay()
+{
+    for (auto &counter : m_sketch)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) / 2, std::memory_order_relaxed);
+    }
+    std::lock_guard<std::mutex> lock(m_hot_mutex);
+    for (auto &[key, estimate] : m_hot)
+    {
+        estimate /= 2;
+    }
+    m_hot_floor /= 2;
+}
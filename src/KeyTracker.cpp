@@ -0,0 +1,227 @@
+#include "KeyTracker.hpp"
+#include "RESPWriter.hpp"
+
+namespace
+{
+    // RESP3 clients get an "invalidate" push; RESP2 redirect targets receive it
+    // as a message on the invalidation channel they subscribed to. A null key
+    // means every key was invalidated.
+    std::shared_ptr<const std::string> encode_invalidation(int protocol, const std::string *key)
+    {
+        auto encoded = std::make_shared<std::string>();
+        RESPWriter writer(*encoded, protocol);
+        if (protocol >= 3)
+        {
+            writer.push_header(2);
+            writer.bulk_string("invalidate");
+        }
+        else
+        {
+            writer.array_header(3);
+            writer.bulk_string("message");
+            writer.bulk_string(KeyTracker::kInvalidateChannel);
+        }
+
+        if (key)
+        {
+            writer.array_header(1);
+            writer.bulk_string(*key);
+        }
+        else
+        {
+            writer.null_array();
+        }
+        return encoded;
+    }
+
+    std::shared_ptr<const std::string> encode_redirect_broken(uint64_t target_id)
+    {
+        auto encoded = std::make_shared<std::string>();
+        RESPWriter writer(*encoded, 3);
+        writer.push_header(2);
+        writer.bulk_string("tracking-redir-broken");
+        writer.integer(static_cast<int64_t>(target_id));
+        return encoded;
+    }
+}
+
+KeyTracker::KeyTracker(const PubSub &pubsub, size_t max_keys) : m_pubsub(pubsub), m_max_keys(max_keys)
+{
+}
+
+void KeyTracker::enable(uint64_t client_id, Subscriber &client, Subscriber &target, const Options &options)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_clients.find(client_id);
+    if (it != m_clients.end())
+    {
+        for (const auto &prefix : it->second.options.prefixes)
+        {
+            m_prefixes[prefix].erase(client_id);
+        }
+    }
+
+    ClientState state{&client, &target, options};
+    if (state.options.broadcast && state.options.prefixes.empty())
+    {
+        state.options.prefixes.push_back("");
+    }
+    for (const auto &prefix : state.options.prefixes)
+    {
+        m_prefixes[prefix].insert(client_id);
+    }
+    m_clients[client_id] = std::move(state);
+}
+
+void KeyTracker::disable(uint64_t client_id)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    disable_locked(client_id);
+}
+
+void KeyTracker::disable_locked(uint64_t client_id)
+{
+    auto it = m_clients.find(client_id);
+    if (it == m_clients.end())
+    {
+        return;
+    }
+    for (const auto &prefix : it->second.options.prefixes)
+    {
+        auto prefix_it = m_prefixes.find(prefix);
+        prefix_it->second.erase(client_id);
+        if (prefix_it->second.empty())
+        {
+            m_prefixes.erase(prefix_it);
+        }
+    }
+    // Entries left in m_keys are skipped once the client is gone and fall
+    // out on the key's next invalidation.
+    m_clients.erase(it);
+}
+
+void KeyTracker::forget(uint64_t client_id, const Subscriber &client)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    disable_locked(client_id);
+
+    std::vector<uint64_t> redirected;
+    for (const auto &[id, state] : m_clients)
+    {
+        if (state.target == &client)
+        {
+            redirected.push_back(id);
+        }
+    }
+    std::shared_ptr<const std::string> encoded;
+    for (uint64_t id : redirected)
+    {
+        Subscriber &tracking = *m_clients.at(id).client;
+        if (tracking.protocol() >= 3)
+        {
+            if (!encoded)
+            {
+                encoded = encode_redirect_broken(client_id);
+            }
+            tracking.deliver(encoded);
+        }
+        disable_locked(id);
+    }
+}
+
+void KeyTracker::remember(uint64_t client_id, const std::string &key)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // tracking may have been turned off behind the client's back
+    if (m_clients.find(client_id) == m_clients.end())
+    {
+        return;
+    }
+    auto it = m_keys.find(key);
+    if (it == m_keys.end())
+    {
+        // Keep the table bounded by invalidating an arbitrary key early; the
+        // clients caching it simply fetch it again.
+        while (!m_keys.empty() && m_keys.size() >= m_max_keys)
+        {
+            std::shared_ptr<const std::string> encoded[2];
+            evict_locked(std::string(m_keys.begin()->first), encoded);
+        }
+        it = m_keys.emplace(key, std::unordered_set<uint64_t>{}).first;
+    }
+    it->second.insert(client_id);
+}
+
+void KeyTracker::invalidate(const std::string &key)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    invalidate_locked(key);
+}
+
+void KeyTracker::invalidate_all()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::shared_ptr<const std::string> encoded[2];
+    for (const auto &[id, state] : m_clients)
+    {
+        send(*state.target, nullptr, encoded);
+    }
+    m_keys.clear();
+}
+
+size_t KeyTracker::tracked_keys() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_keys.size();
+}
+
+void KeyTracker::invalidate_locked(const std::string &key)
+{
+    std::shared_ptr<const std::string> encoded[2];
+    evict_locked(key, encoded);
+
+    for (const auto &[prefix, ids] : m_prefixes)
+    {
+        if (key.compare(0, prefix.size(), prefix) != 0)
+        {
+            continue;
+        }
+        for (uint64_t id : ids)
+        {
+            send(*m_clients.at(id).target, &key, encoded);
+        }
+    }
+}
+
+void KeyTracker::evict_locked(const std::string &key, std::shared_ptr<const std::string> encoded[2])
+{
+    auto it = m_keys.find(key);
+    if (it == m_keys.end())
+    {
+        return;
+    }
+    for (uint64_t id : it->second)
+    {
+        auto client = m_clients.find(id);
+        if (client != m_clients.end() && !client->second.options.broadcast)
+        {
+            send(*client->second.target, &key, encoded);
+        }
+    }
+    m_keys.erase(it);
+}
+
+void KeyTracker::send(Subscriber &target, const std::string *key, std::shared_ptr<const std::string> encoded[2])
+{
+    // a RESP2 connection is only sent what it subscribed to
+    if (target.protocol() < 3 && !m_pubsub.is_subscribed(target, kInvalidateChannel))
+    {
+        return;
+    }
+    auto &buffer = encoded[target.protocol() >= 3 ? 1 : 0];
+    if (!buffer)
+    {
+        buffer = encode_invalidation(target.protocol(), key);
+    }
+    target.deliver(buffer);
+}
@@ -0,0 +1,73 @@
+#include "LazyFree.hpp"
+
+LazyFree::~LazyFree()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_work_cv.notify_one();
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+}
+
+LazyFree::Stats LazyFree::stats() const
+{
+    return Stats{m_pending_objects.load(), m_pending_bytes.load(), m_freed_objects.load()};
+}
+
+void LazyFree::wait_idle()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle_cv.wait(lock, [this]
+                   { return m_queue.empty() && !m_busy; });
+}
+
+void LazyFree::enqueue(std::unique_ptr<Garbage> garbage, size_t bytes)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_thread.joinable())
+        {
+            m_thread = std::thread(&LazyFree::run, this);
+        }
+        m_queue.push_back(Item{std::move(garbage), bytes});
+        m_pending_objects++;
+        m_pending_bytes += bytes;
+    }
+    m_work_cv.notify_one();
+}
+
+void LazyFree::run()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        m_work_cv.wait(lock, [this]
+                       { return m_stop || !m_queue.empty(); });
+        // Drain whatever is queued even when stopping, so nothing leaks.
+        if (m_queue.empty())
+        {
+            return;
+        }
+
+        Item item = std::move(m_queue.front());
+        m_queue.pop_front();
+        m_busy = true;
+        lock.unlock();
+
+        item.garbage.reset();
+        m_pending_objects--;
+        m_pending_bytes -= item.bytes;
+        m_freed_objects++;
+
+        lock.lock();
+        m_busy = false;
+        if (m_queue.empty())
+        {
+            m_idle_cv.notify_all();
+        }
+    }
+}
@@ -0,0 +1,288 @@
+#include <algorithm>
+#include <mutex>
+
+#include "PubSub.hpp"
+#include "RESPWriter.hpp"
+
+namespace
+{
+    std::shared_ptr<const std::string> encode_message(int protocol, const std::string *pattern,
+                                                      const std::string &channel, const std::string &message)
+    {
+        auto encoded = std::make_shared<std::string>();
+        encoded->reserve(channel.size() + message.size() + (pattern ? pattern->size() : 0) + 48);
+        RESPWriter writer(*encoded, protocol);
+        writer.push_header(pattern ? 4 : 3);
+        writer.bulk_string(pattern ? "pmessage" : "message");
+        if (pattern)
+        {
+            writer.bulk_string(*pattern);
+        }
+        writer.bulk_string(channel);
+        writer.bulk_string(message);
+        return encoded;
+    }
+
+    // Hands `message` to every subscriber, encoding it at most once for each
+    // protocol version in use among them.
+    size_t fan_out(const std::unordered_set<Subscriber *> &subscribers, const std::string *pattern,
+                   const std::string &channel, const std::string &message)
+    {
+        std::shared_ptr<const std::string> encoded[2];
+        for (Subscriber *subscriber : subscribers)
+        {
+            auto &buffer = encoded[subscriber->protocol() >= 3 ? 1 : 0];
+            if (!buffer)
+            {
+                buffer = encode_message(subscriber->protocol(), pattern, channel, message);
+            }
+            subscriber->deliver(buffer);
+        }
+        return subscribers.size();
+    }
+}
+
+size_t PubSub::subscribe(Subscriber &subscriber, const std::string &channel)
+{
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    if (m_subscriptions[&subscriber].channels.insert(channel).second)
+    {
+        m_channels[channel].insert(&subscriber);
+    }
+    return count_locked(subscriber);
+}
+
+size_t PubSub::unsubscribe(Subscriber &subscriber, const std::string &channel)
+{
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    auto it = m_subscriptions.find(&subscriber);
+    if (it != m_subscriptions.end() && it->second.channels.erase(channel) > 0)
+    {
+        auto channel_it = m_channels.find(channel);
+        channel_it->second.erase(&subscriber);
+        if (channel_it->second.empty())
+        {
+            m_channels.erase(channel_it);
+        }
+    }
+    return count_locked(subscriber);
+}
+
+size_t PubSub::psubscribe(Subscriber &subscriber, const std::string &pattern)
+{
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    if (m_subscriptions[&subscriber].patterns.insert(pattern).second)
+    {
+        m_patterns[pattern].insert(&subscriber);
+    }
+    return count_locked(subscriber);
+}
+
+size_t PubSub::punsubscribe(Subscriber &subscriber, const std::string &pattern)
+{
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    auto it = m_subscriptions.find(&subscriber);
+    if (it != m_subscriptions.end() && it->second.patterns.erase(pattern) > 0)
+    {
+        auto pattern_it = m_patterns.find(pattern);
+        pattern_it->second.erase(&subscriber);
+        if (pattern_it->second.empty())
+        {
+            m_patterns.erase(pattern_it);
+        }
+    }
+    return count_locked(subscriber);
+}
+
+void PubSub::unsubscribe_all(Subscriber &subscriber)
+{
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    auto it = m_subscriptions.find(&subscriber);
+    if (it == m_subscriptions.end())
+    {
+        return;
+    }
+
+    for (const auto &channel : it->second.channels)
+    {
+        auto channel_it = m_channels.find(channel);
+        channel_it->second.erase(&subscriber);
+        if (channel_it->second.empty())
+        {
+            m_channels.erase(channel_it);
+        }
+    }
+    for (const auto &pattern : it->second.patterns)
+    {
+        auto pattern_it = m_patterns.find(pattern);
+        pattern_it->second.erase(&subscriber);
+        if (pattern_it->second.empty())
+        {
+            m_patterns.erase(pattern_it);
+        }
+    }
+    m_subscriptions.erase(it);
+}
+
+std::vector<std::string> PubSub::channels(const Subscriber &subscriber) const
+{
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    auto it = m_subscriptions.find(&subscriber);
+    if (it == m_subscriptions.end())
+    {
+        return {};
+    }
+    return std::vector<std::string>(it->second.channels.begin(), it->second.channels.end());
+}
+
+std::vector<std::string> PubSub::patterns(const Subscriber &subscriber) const
+{
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    auto it = m_subscriptions.find(&subscriber);
+    if (it == m_subscriptions.end())
+    {
+        return {};
+    }
+    return std::vector<std::string>(it->second.patterns.begin(), it->second.patterns.end());
+}
+
+size_t PubSub::subscription_count(const Subscriber &subscriber) const
+{
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    return count_locked(subscriber);
+}
+
+bool PubSub::is_subscribed(const Subscriber &subscriber, const std::string &channel) const
+{
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    auto it = m_subscriptions.find(&subscriber);
+    return it != m_subscriptions.end() && it->second.channels.count(channel) > 0;
+}
+
+size_t PubSub::publish(const std::string &channel, const std::string &message)
+{
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    size_t receivers = 0;
+
+    auto it = m_channels.find(channel);
+    if (it != m_channels.end())
+    {
+        receivers += fan_out(it->second, nullptr, channel, message);
+    }
+
+    for (const auto &[pattern, subscribers] : m_patterns)
+    {
+        if (pattern_matches(pattern, channel))
+        {
+            receivers += fan_out(subscribers, &pattern, channel, message);
+        }
+    }
+    return receivers;
+}
+
+bool PubSub::pattern_matches(std::string_view pattern, std::string_view text)
+{
+    size_t p = 0;
+    size_t t = 0;
+    // Position to resume from after the most recent '*', for backtracking.
+    size_t star_p = std::string_view::npos;
+    size_t star_t = 0;
+
+    while (t < text.size())
+    {
+        if (p < pattern.size())
+        {
+            char c = pattern[p];
+            if (c == '*')
+            {
+                star_p = ++p;
+                star_t = t;
+                continue;
+            }
+            if (c == '?')
+            {
+                p++;
+                t++;
+                continue;
+            }
+            if (c == '[')
+            {
+                size_t q = p + 1;
+                bool negate = q < pattern.size() && pattern[q] == '^';
+                if (negate)
+                {
+                    q++;
+                }
+                bool matched = false;
+                while (q < pattern.size() && pattern[q] != ']')
+                {
+                    if (pattern[q] == '\\' && q + 1 < pattern.size())
+                    {
+                        matched |= pattern[q + 1] == text[t];
+                        q += 2;
+                    }
+                    else if (q + 2 < pattern.size() && pattern[q + 1] == '-' && pattern[q + 2] != ']')
+                    {
+                        char low = std::min(pattern[q], pattern[q + 2]);
+                        char high = std::max(pattern[q], pattern[q + 2]);
+                        matched |= text[t] >= low && text[t] <= high;
+                        q += 3;
+                    }
+                    else
+                    {
+                        matched |= pattern[q] == text[t];
+                        q++;
+                    }
+                }
+                if (matched != negate)
+                {
+                    p = q < pattern.size() ? q + 1 : q;
+                    t++;
+                    continue;
+                }
+            }
+            else
+            {
+                if (c == '\\' && p + 1 < pattern.size())
+                {
+                    c = pattern[p + 1];
+                    if (c == text[t])
+                    {
+                        p += 2;
+                        t++;
+                        continue;
+                    }
+                }
+                else if (c == text[t])
+                {
+                    p++;
+                    t++;
+                    continue;
+                }
+            }
+        }
+
+        if (star_p == std::string_view::npos)
+        {
+            return false;
+        }
+        p = star_p;
+        t = ++star_t;
+    }
+
+    while (p < pattern.size() && pattern[p] == '*')
+    {
+        p++;
+    }
+    return p == pattern.size();
+}
+
+size_t PubSub::count_locked(const Subscriber &subscriber) const
+{
+    auto it = m_subscriptions.find(&subscriber);
+    if (it == m_subscriptions.end())
+    {
+        return 0;
+    }
+    return it->second.channels.size() + it->second.patterns.size();
+}
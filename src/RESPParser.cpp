@@ -1,78 +1,200 @@
+#include <algorithm>
+#include <cstring>
 #include <stdexcept>
 #include "RESPParser.hpp"
+#include "RESPScanner.hpp"
 
-RESPParser::RESPParser(const std::string &data) : m_data(data), m_pos(0)
+namespace
+{
+    constexpr size_t kScanBlock = 1024;
+    constexpr int64_t kMaxMultibulkLength = 1024 * 1024;
+    constexpr int64_t kMaxBulkLength = 512 * 1024 * 1024;
+    constexpr size_t kMaxInlineLength = 64 * 1024;
+}
+
+RESPParser::RESPParser(std::string_view data)
+    : m_data(data), m_pos(0), m_incomplete(false), m_crlf_index(0), m_scanned(0)
 {
 }
 
 bool RESPParser::has_next()
 {
-    return m_pos < m_data.size();
+    return !m_incomplete && m_pos < m_data.size();
 }
 
 std::vector<std::string> RESPParser::next_command()
 {
-    std::vector<std::string> command;
-
     if (m_pos > m_data.size())
     {
         throw std::runtime_error("No more data to parse");
     }
 
-    if (m_data[m_pos] != '*')
+    std::vector<std::string_view> args;
+    if (!try_next_command(args))
     {
-        throw std::runtime_error("Expected array");
+        throw std::runtime_error("Incomplete data");
     }
+    return std::vector<std::string>(args.begin(), args.end());
+}
 
-    m_pos += 1; // skip '*'
+bool RESPParser::try_next_command(std::vector<std::string_view> &args)
+{
+    args.clear();
+    if (!has_next())
+    {
+        return false;
+    }
 
-    size_t line_end = m_data.find("\r\n", m_pos);
-    if (line_end == std::string::npos)
+    bool complete = m_data[m_pos] == '*' ? parse_multibulk(args) : parse_inline(args);
+    if (!complete)
     {
-        // Incomplete data
-        m_pos -= 1;
-        throw std::runtime_error("Incomplete data");
+        // The CRLF index has been consumed past the partial command, so a retry
+        // on the same buffer could not be parsed correctly; wait for more data.
+        m_incomplete = true;
+        args.clear();
+    }
+    return complete;
+}
+
+std::string RESPParser::get_remaining_data() const
+{
+    return std::string(m_data.substr(m_pos));
+}
+
+size_t RESPParser::consumed() const
+{
+    return m_pos;
+}
+
+bool RESPParser::parse_multibulk(std::vector<std::string_view> &args)
+{
+    const char *data = m_data.data();
+    size_t size = m_data.size();
+    size_t pos = m_pos + 1; // skip '*'
+
+    size_t line_end = find_crlf(pos);
+    if (line_end == std::string_view::npos)
+    {
+        return false;
     }
 
-    int array_length = std::stoi(m_data.substr(m_pos, line_end - m_pos));
-    m_pos = line_end + 2; // move past "\r\n"
+    int64_t array_length;
+    if (!resp::parse_length(data + pos, data + line_end, kMaxMultibulkLength, array_length))
+    {
+        throw std::runtime_error("Invalid multibulk length");
+    }
+    pos = line_end + 2; // move past "\r\n"
 
-    for (int i = 0; i < array_length; i++)
+    for (int64_t i = 0; i < array_length; i++)
     {
-        // Expect bulk string
-        if (m_pos >= m_data.size() || m_data[m_pos] != '$')
+        if (pos >= size)
+        {
+            return false;
+        }
+        if (data[pos] != '$')
         {
             throw std::runtime_error("Expected bulk string");
         }
 
-        m_pos++; // Skip '$'
-        line_end = m_data.find("\r\n", m_pos);
-        if (line_end == std::string::npos)
+        line_end = find_crlf(pos + 1);
+        if (line_end == std::string_view::npos)
         {
-            // incomplete
-            m_pos -= 1;
-            throw std::runtime_error("Incomplete data");
+            return false;
         }
 
-        int str_length = std::stoi(m_data.substr(m_pos, line_end - m_pos));
-        m_pos = line_end + 2; // Move past "\r\n"
+        int64_t str_length;
+        if (!resp::parse_length(data + pos + 1, data + line_end, kMaxBulkLength, str_length))
+        {
+            throw std::runtime_error("Invalid bulk length");
+        }
+        pos = line_end + 2; // move past "\r\n"
 
-        if (m_pos + str_length + 2 > m_data.size())
+        if (pos + str_length + 2 > size)
+        {
+            return false;
+        }
+        if (data[pos + str_length] != '\r' || data[pos + str_length + 1] != '\n')
         {
-            // incomplete
-            m_pos -= (line_end - m_pos) + 3; // Rewind to '$'
-            throw std::runtime_error("Incomplete data");
+            throw std::runtime_error("Expected CRLF after bulk string");
         }
 
-        std::string arg = m_data.substr(m_pos, str_length);
-        command.push_back(arg);
-        m_pos += str_length + 2; // string + "\r\n"
+        args.emplace_back(data + pos, static_cast<size_t>(str_length));
+        pos += str_length + 2; // string + "\r\n"
     }
 
-    return command;
+    m_pos = pos;
+    return true;
 }
 
-std::string RESPParser::get_remaining_data() const
+bool RESPParser::parse_inline(std::vector<std::string_view> &args)
 {
-    return m_data.substr(m_pos);
+    const char *data = m_data.data();
+    size_t size = m_data.size();
+
+    const void *newline = std::memchr(data + m_pos, '\n', size - m_pos);
+    if (newline == nullptr)
+    {
+        if (size - m_pos > kMaxInlineLength)
+        {
+            throw std::runtime_error("Too big inline request");
+        }
+        return false;
+    }
+
+    size_t line_end = static_cast<const char *>(newline) - data;
+    size_t end = line_end;
+    if (end > m_pos && data[end - 1] == '\r')
+    {
+        end--;
+    }
+
+    size_t pos = m_pos;
+    while (pos < end)
+    {
+        while (pos < end && (data[pos] == ' ' || data[pos] == '\t'))
+        {
+            pos++;
+        }
+        size_t start = pos;
+        while (pos < end && data[pos] != ' ' && data[pos] != '\t')
+        {
+            pos++;
+        }
+        if (pos > start)
+        {
+            args.emplace_back(data + start, pos - start);
+        }
+    }
+
+    m_pos = line_end + 1;
+    return true;
+}
+
+size_t RESPParser::find_crlf(size_t from)
+{
+    while (true)
+    {
+        while (m_crlf_index < m_crlf.size() && m_crlf[m_crlf_index] < from)
+        {
+            m_crlf_index++;
+        }
+        if (m_crlf_index < m_crlf.size())
+        {
+            return m_crlf[m_crlf_index];
+        }
+
+        // Everything before `from` has been consumed, so scanning resumes there
+        // rather than at the end of the previous block.
+        m_scanned = std::max(m_scanned, from);
+        if (m_scanned >= m_data.size())
+        {
+            return std::string_view::npos;
+        }
+
+        size_t to = std::min(m_data.size(), m_scanned + kScanBlock);
+        m_crlf.clear();
+        m_crlf_index = 0;
+        resp::find_crlf(m_data.data(), m_data.size(), m_scanned, to, m_crlf);
+        m_scanned = to;
+    }
 }
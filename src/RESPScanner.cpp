@@ -0,0 +1,112 @@
+#include "RESPScanner.hpp"
+#include "CpuFeatures.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RESP_SCANNER_X86 1
+#endif
+
+namespace resp
+{
+    void find_crlf_scalar(const char *data, size_t size, size_t from, size_t to, std::vector<size_t> &out)
+    {
+        for (size_t i = from; i < to && i + 1 < size; i++)
+        {
+            if (data[i] == '\r' && data[i + 1] == '\n')
+            {
+                out.push_back(i);
+            }
+        }
+    }
+
+#ifdef RESP_SCANNER_X86
+    // Both vector kernels compare one block against '\r' and the same block
+    // shifted by one byte against '\n'; ANDing the two masks marks every CRLF
+    // in a single pass, including pairs that straddle block boundaries.
+
+    __attribute__((target("sse2"))) void find_crlf_sse2(const char *data, size_t size, size_t from, size_t to, std::vector<size_t> &out)
+    {
+        const __m128i cr = _mm_set1_epi8('\r');
+        const __m128i lf = _mm_set1_epi8('\n');
+        size_t i = from;
+        for (; i + 16 <= to && i + 16 < size; i += 16)
+        {
+            __m128i head = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+            __m128i next = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i + 1));
+            unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(head, cr)) &
+                                                  _mm_movemask_epi8(_mm_cmpeq_epi8(next, lf)));
+            while (mask != 0)
+            {
+                out.push_back(i + __builtin_ctz(mask));
+                mask &= mask - 1;
+            }
+        }
+        find_crlf_scalar(data, size, i, to, out);
+    }
+
+    __attribute__((target("avx2"))) void find_crlf_avx2(const char *data, size_t size, size_t from, size_t to, std::vector<size_t> &out)
+    {
+        const __m256i cr = _mm256_set1_epi8('\r');
+        const __m256i lf = _mm256_set1_epi8('\n');
+        size_t i = from;
+        for (; i + 32 <= to && i + 32 < size; i += 32)
+        {
+            __m256i head = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+            __m256i next = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i + 1));
+            unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(head, cr)) &
+                                                  _mm256_movemask_epi8(_mm256_cmpeq_epi8(next, lf)));
+            while (mask != 0)
+            {
+                out.push_back(i + __builtin_ctz(mask));
+                mask &= mask - 1;
+            }
+        }
+        find_crlf_sse2(data, size, i, to, out);
+    }
+#else
+    void find_crlf_sse2(const char *data, size_t size, size_t from, size_t to, std::vector<size_t> &out)
+    {
+        find_crlf_scalar(data, size, from, to, out);
+    }
+
+    void find_crlf_avx2(const char *data, size_t size, size_t from, size_t to, std::vector<size_t> &out)
+    {
+        find_crlf_scalar(data, size, from, to, out);
+    }
+#endif
+
+    void find_crlf(const char *data, size_t size, size_t from, size_t to, std::vector<size_t> &out)
+    {
+        using Kernel = void (*)(const char *, size_t, size_t, size_t, std::vector<size_t> &);
+        static const Kernel kernel = cpu::has_avx2()   ? find_crlf_avx2
+                                     : cpu::has_sse2() ? find_crlf_sse2
+                                                       : find_crlf_scalar;
+        kernel(data, size, from, to, out);
+    }
+
+    bool parse_length(const char *begin, const char *end, int64_t max_value, int64_t &value)
+    {
+        // Lengths on the wire are short, so a plain loop with a single range
+        // check per digit beats anything fancier. 18 digits cannot overflow.
+        if (begin == end || end - begin > 18)
+        {
+            return false;
+        }
+        int64_t result = 0;
+        for (const char *p = begin; p != end; p++)
+        {
+            unsigned digit = static_cast<unsigned char>(*p) - static_cast<unsigned>('0');
+            if (digit > 9)
+            {
+                return false;
+            }
+            result = result * 10 + digit;
+        }
+        if (result > max_value)
+        {
+            return false;
+        }
+        value = result;
+        return true;
+    }
+}
@@ -0,0 +1,169 @@
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+
+#include "RESPWriter.hpp"
+
+namespace
+{
+    constexpr int kSharedIntegers = 10000;
+    constexpr int kSharedHeaders = 32;
+
+    // Encodes "<prefix><n>\r\n" for every n in [0, count) into one block so
+    // common small integers and aggregate headers are a single memcpy.
+    template <int Count>
+    struct SharedTable
+    {
+        explicit SharedTable(char prefix)
+        {
+            for (int i = 0; i < Count; i++)
+            {
+                offsets[i] = static_cast<uint32_t>(data.size());
+                data.push_back(prefix);
+                data.append(std::to_string(i));
+                data.append("\r\n");
+            }
+            offsets[Count] = static_cast<uint32_t>(data.size());
+        }
+
+        std::string_view get(int64_t i) const
+        {
+            return std::string_view(data).substr(offsets[i], offsets[i + 1] - offsets[i]);
+        }
+
+        std::string data;
+        std::array<uint32_t, Count + 1> offsets;
+    };
+
+    const SharedTable<kSharedIntegers> integers(':');
+    const SharedTable<kSharedHeaders> bulk_headers('$');
+    const SharedTable<kSharedHeaders> array_headers('*');
+}
+
+void RESPWriter::simple_string(std::string_view value)
+{
+    m_out.push_back('+');
+    m_out.append(value);
+    m_out.append("\r\n", 2);
+}
+
+void RESPWriter::error(std::string_view message)
+{
+    m_out.push_back('-');
+    m_out.append(message);
+    m_out.append("\r\n", 2);
+}
+
+void RESPWriter::integer(int64_t value)
+{
+    if (value >= 0 && value < kSharedIntegers)
+    {
+        m_out.append(integers.get(value));
+        return;
+    }
+    prefixed_integer(':', value);
+}
+
+void RESPWriter::bulk_string(std::string_view value)
+{
+    if (value.size() < kSharedHeaders)
+    {
+        m_out.append(bulk_headers.get(value.size()));
+    }
+    else
+    {
+        prefixed_integer('$', static_cast<int64_t>(value.size()));
+    }
+    m_out.append(value);
+    m_out.append("\r\n", 2);
+}
+
+void RESPWriter::null()
+{
+    m_out.append(m_protocol >= 3 ? shared_reply::null_resp3 : shared_reply::null_bulk);
+}
+
+void RESPWriter::null_array()
+{
+    m_out.append(m_protocol >= 3 ? shared_reply::null_resp3 : shared_reply::null_array);
+}
+
+void RESPWriter::array_header(size_t length)
+{
+    if (length < kSharedHeaders)
+    {
+        m_out.append(array_headers.get(length));
+        return;
+    }
+    prefixed_integer('*', static_cast<int64_t>(length));
+}
+
+void RESPWriter::map_header(size_t pairs)
+{
+    if (m_protocol >= 3)
+    {
+        prefixed_integer('%', static_cast<int64_t>(pairs));
+        return;
+    }
+    array_header(pairs * 2);
+}
+
+void RESPWriter::push_header(size_t length)
+{
+    if (m_protocol >= 3)
+    {
+        prefixed_integer('>', static_cast<int64_t>(length));
+        return;
+    }
+    array_header(length);
+}
+
+void RESPWriter::double_value(double value)
+{
+    char buffer[32];
+    size_t length;
+    if (std::isinf(value))
+    {
+        length = static_cast<size_t>(std::snprintf(buffer, sizeof(buffer), "%s", value > 0 ? "inf" : "-inf"));
+    }
+    else if (std::isnan(value))
+    {
+        length = static_cast<size_t>(std::snprintf(buffer, sizeof(buffer), "nan"));
+    }
+    else
+    {
+        // Shortest representation that round-trips.
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        length = static_cast<size_t>(result.ptr - buffer);
+    }
+
+    if (m_protocol >= 3)
+    {
+        m_out.push_back(',');
+        m_out.append(buffer, length);
+        m_out.append("\r\n", 2);
+        return;
+    }
+    bulk_string(std::string_view(buffer, length));
+}
+
+void RESPWriter::boolean(bool value)
+{
+    if (m_protocol >= 3)
+    {
+        m_out.append(value ? "#t\r\n" : "#f\r\n", 4);
+        return;
+    }
+    integer(value ? 1 : 0);
+}
+
+void RESPWriter::prefixed_integer(char prefix, int64_t value)
+{
+    char buffer[24];
+    buffer[0] = prefix;
+    auto result = std::to_chars(buffer + 1, buffer + sizeof(buffer) - 2, value);
+    result.ptr[0] = '\r';
+    result.ptr[1] = '\n';
+    m_out.append(buffer, static_cast<size_t>(result.ptr + 2 - buffer));
+}
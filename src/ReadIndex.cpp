@@ -0,0 +1,140 @@
+#include <functional>
+
+#include "Epoch.hpp"
+#include "ReadIndex.hpp"
+
+ReadIndex::Table::Table(size_t bucket_count)
+    : mask(bucket_count - 1), buckets(new std::atomic<Node *>[bucket_count])
+{
+    for (size_t i = 0; i < bucket_count; i++)
+    {
+        buckets[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+ReadIndex::ReadIndex() : m_table(new Table(kInitialBuckets))
+{
+}
+
+ReadIndex::~ReadIndex()
+{
+    // No reader can be left once the owner is being destroyed.
+    delete_table(m_table.load());
+}
+
+const ReadIndex::Node *ReadIndex::find(std::string_view key) const
+{
+    size_t hash = std::hash<std::string_view>{}(key);
+    const Table *table = m_table.load(std::memory_order_acquire);
+    const Node *node = table->buckets[hash & table->mask].load(std::memory_order_acquire);
+    for (; node; node = node->next.load(std::memory_order_acquire))
+    {
+        if (node->hash == hash && node->key == key)
+        {
+            return node;
+        }
+    }
+    return nullptr;
+}
+
+void ReadIndex::insert(const std::string &key, const std::string *value,
+                       std::optional<Clock::time_point> expiry, uint32_t last_access)
+{
+    size_t hash = std::hash<std::string_view>{}(key);
+    Table *table = m_table.load(std::memory_order_relaxed);
+    auto &head = table->buckets[hash & table->mask];
+    Node *node = new Node(key, hash, value, expiry, last_access);
+
+    std::atomic<Node *> *link = &head;
+    for (Node *current = link->load(std::memory_order_relaxed); current; current = link->load(std::memory_order_relaxed))
+    {
+        if (current->hash == hash && current->key == key)
+        {
+            node->next.store(current->next.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            current->owns_value = current->value != value;
+            link->store(node, std::memory_order_release);
+            epoch::retire(current, delete_node);
+            return;
+        }
+        link = &current->next;
+    }
+
+    node->next.store(head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    head.store(node, std::memory_order_release);
+    if (++m_size > table->mask + 1)
+    {
+        grow();
+    }
+}
+
+void ReadIndex::erase(const std::string &key)
+{
+    size_t hash = std::hash<std::string_view>{}(key);
+    Table *table = m_table.load(std::memory_order_relaxed);
+    std::atomic<Node *> *link = &table->buckets[hash & table->mask];
+    for (Node *current = link->load(std::memory_order_relaxed); current; current = link->load(std::memory_order_relaxed))
+    {
+        if (current->hash == hash && current->key == key)
+        {
+            link->store(current->next.load(std::memory_order_relaxed), std::memory_order_release);
+            epoch::retire(current, delete_node);
+            m_size--;
+            return;
+        }
+        link = &current->next;
+    }
+}
+
+void ReadIndex::clear()
+{
+    Table *old = m_table.exchange(new Table(kInitialBuckets), std::memory_order_acq_rel);
+    epoch::retire(old, delete_table);
+    m_size = 0;
+}
+
+void ReadIndex::grow()
+{
+    Table *old = m_table.load(std::memory_order_relaxed);
+    size_t bucket_count = (old->mask + 1) * 2;
+    auto *table = new Table(bucket_count);
+    for (size_t i = 0; i <= old->mask; i++)
+    {
+        for (Node *node = old->buckets[i].load(std::memory_order_relaxed); node; node = node->next.load(std::memory_order_relaxed))
+        {
+            auto *clone = new Node(node->key, node->hash, node->value, node->expiry,
+                                   node->last_access.load(std::memory_order_relaxed));
+            auto &head = table->buckets[node->hash & table->mask];
+            clone->next.store(head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            head.store(clone, std::memory_order_relaxed);
+            node->owns_value = false;
+        }
+    }
+    m_table.store(table, std::memory_order_release);
+    epoch::retire(old, delete_table);
+}
+
+void ReadIndex::delete_node(void *pointer)
+{
+    auto *node = static_cast<Node *>(pointer);
+    if (node->owns_value)
+    {
+        delete node->value;
+    }
+    delete node;
+}
+
+void ReadIndex::delete_table(void *pointer)
+{
+    auto *table = static_cast<Table *>(pointer);
+    for (size_t i = 0; i <= table->mask; i++)
+    {
+        Node *node = table->buckets[i].load(std::memory_order_relaxed);
+        while (node)
+        {
+            Node *next = node->next.load(std::memory_order_relaxed);
+            delete_node(node);
+            node = next;
+        }
+    }
+    delete table;
+}
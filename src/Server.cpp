@@ -1,15 +1,34 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
 #include <thread>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/uio.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <unistd.h>
 
 #include "Server.hpp"
 #include "RESPParser.hpp"
+#include "RESPWriter.hpp"
 
 #define SOCK_INVALID -1
 
-Server::Server(int port) : m_port(port), m_shutdown(false)
+Server::Server(int port, int io_threads) : m_port(port), m_io_threads(io_threads), m_shutdown(false), m_tracker(m_pubsub)
 {
+    m_data_store.set_key_listener([this](const std::string &key)
+                                  {
+                                      m_tracker.invalidate(key);
+                                      // only ever filled on the coroutine loop, which also runs every write
+                                      if (!m_blocked.empty())
+                                      {
+                                          wake_blocked(key);
+                                      }
+                                  });
+    m_data_store.set_flush_listener([this]()
+                                    { m_tracker.invalidate_all(); });
+
     m_server_socket = socket(AF_INET, SOCK_STREAM, 0);
     if (m_server_socket == SOCK_INVALID)
     {
@@ -29,10 +48,18 @@ Server::Server(int port) : m_port(port), m_shutdown(false)
 
     if (bind(m_server_socket, (sockaddr *)&server_addr, sizeof(server_addr)) < 0)
     {
-        std::string err("Failed to bind to port=" + m_port);
+        std::string err("Failed to bind to port=" + std::to_string(m_port));
         throw std::runtime_error(err);
     }
 
+    if (m_port == 0)
+    {
+        // an ephemeral port was requested; report the one we got
+        socklen_t addr_len = sizeof(server_addr);
+        getsockname(m_server_socket, (sockaddr *)&server_addr, &addr_len);
+        m_port = ntohs(server_addr.sin_port);
+    }
+
     if (listen(m_server_socket, SOMAXCONN) < 0)
     {
         throw std::runtime_error("Failed to listen on socket");
@@ -43,44 +70,13 @@ void Server::start(void)
 {
     std::cout << "Server started on port " << m_port << std::endl;
 
-    fd_set read_fds;
-    timeval timeout;
-
-    while (!m_shutdown)
+    if (m_io_threads > 0)
     {
-        FD_ZERO(&read_fds);
-        FD_SET(m_server_socket, &read_fds);
-        int max_fd = m_server_socket;
-
-        timeout.tv_sec = 1;
-        timeout.tv_usec = 0;
-
-        int res = select(max_fd + 1, &read_fds, nullptr, nullptr, &timeout);
-
-        if (res < 0 && errno != EINTR)
-        {
-            std::cerr << "Select error" << std::endl;
-            break;
-        }
-
-        if (res > 0)
-        {
-            if (FD_ISSET(m_server_socket, &read_fds))
-            {
-                sockaddr_in client_addr{};
-                socklen_t client_len = sizeof(client_addr);
-                int client_socket = accept(m_server_socket, (sockaddr *)&client_addr, &client_len);
-
-                if (client_socket >= 0)
-                {
-                    std::thread(&Server::handle_client, this, client_socket).detach();
-                }
-                else
-                {
-                    std::cerr << "Failed to accept client connection" << std::endl;
-                }
-            }
-        }
+        serve_threaded_io();
+    }
+    else
+    {
+        serve_coroutines();
     }
 
     close(m_server_socket);
@@ -92,225 +88,1605 @@ void Server::stop()
     m_shutdown = true;
 }
 
-void Server::handle_client(int client_socket)
+int Server::port() const
 {
-    try
-    {
-        char buffer[1024] = {0};
-        std::string data_buffer;
-        ssize_t bytes_received;
+    return m_port;
+}
 
-        while (true)
-        {
-            bytes_received = recv(client_socket, buffer, sizeof(buffer), 0);
+void Server::enable_tiering(DataStore::TieringOptions options)
+{
+    m_data_store.enable_tiering(std::move(options));
+}
 
-            if (bytes_received > 0)
-            {
-                data_buffer.append(buffer, bytes_received);
+void Server::set_compression_threshold(size_t threshold)
+{
+    m_data_store.set_compression_threshold(threshold);
+}
 
-                RESPParser parser(data_buffer);
+void Server::serve_coroutines()
+{
+    // Every command runs on this thread, so the store can skip its lock.
+    m_data_store.set_single_threaded(true);
+    m_can_block = true;
+    m_read_buffer.resize(16 * 1024);
+    fcntl(m_server_socket, F_SETFL, fcntl(m_server_socket, F_GETFL) | O_NONBLOCK);
 
-                while (parser.has_next())
-                {
-                    auto command = parser.next_command();
-                    process_command(client_socket, command);
-                }
+    auto has_clients = [this]
+    {
+        std::lock_guard<std::mutex> lock(m_clients_mutex);
+        return !m_clients.empty();
+    };
 
-                // remove the processed part from the buffer
-                data_buffer = parser.get_remaining_data();
-            }
-            else if (bytes_received == 0)
-            {
-                // client disconnected
-                std::cout << "Client disconnected." << std::endl; // TODO: log client address?
-                break;
-            }
-            else
-            {
-                // err
-                std::cerr << "Recv failed." << std::endl; // TODO: log errno
-                break;
-            }
+    m_accepting = true;
+    accept_connections();
+    m_cron_running = true;
+    cron();
+    while (!m_shutdown)
+    {
+        m_loop.run_once(std::chrono::milliseconds(100));
+    }
+
+    // Let every coroutine run to completion so none outlives the server.
+    m_loop.wake(m_server_socket);
+    {
+        std::lock_guard<std::mutex> lock(m_clients_mutex);
+        for (const auto &[id, client] : m_clients)
+        {
+            shutdown(client->socket, SHUT_RDWR);
         }
     }
-    catch (const std::exception &e)
+    for (const auto &[key, waiters] : m_blocked)
+    {
+        for (KeyWait *waiter : waiters)
+        {
+            waiter->resume();
+        }
+    }
+    while (m_accepting || m_cron_running || has_clients())
     {
-        std::cerr << "Exception in handle_client: " << e.what() << std::endl;
+        m_loop.run_once(std::chrono::milliseconds(100));
     }
 
-    close(client_socket);
+    m_can_block = false;
+    m_data_store.set_single_threaded(false);
 }
 
-void Server::process_command(int client_socket, const std::vector<std::string> &command)
+Task Server::cron()
 {
-    if (command.empty())
+    while (!m_shutdown)
     {
-        return;
+        co_await m_loop.sleep_for(kCronInterval);
+        m_data_store.run_tiering();
     }
+    m_cron_running = false;
+}
 
-    std::string cmd = command[0];
-    std::transform(cmd.begin(), cmd.end(), cmd.begin(), ::toupper);
-
-    std::string response;
-
-    if (cmd == "PING")
+Task Server::accept_connections()
+{
+    m_loop.watch(m_server_socket);
+    while (!m_shutdown)
     {
-        if (command.size() == 1)
+        int client_socket = accept4(m_server_socket, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (client_socket >= 0)
         {
-            response = "+PONG\r\n";
+            // runs until the connection first has to wait
+            serve_connection(client_socket);
         }
-        else if (command.size() == 2)
+        else if (errno == EAGAIN || errno == EWOULDBLOCK)
         {
-            response = "+" + command[1] + "\r\n";
+            co_await m_loop.readable(m_server_socket);
         }
-        else
+        else if (errno != EINTR && errno != ECONNABORTED)
         {
-            response = "-ERR wrong number of arguments for 'PING' command\r\n";
+            std::cerr << "Failed to accept client connection" << std::endl;
+            co_await m_loop.readable(m_server_socket);
         }
     }
-    else if (cmd == "ECHO")
+    m_loop.unwatch(m_server_socket);
+    m_accepting = false;
+}
+
+Task Server::serve_connection(int client_socket)
+{
+    Client client(m_next_client_id++, client_socket);
+    // Pushes come from commands run on this same thread: resume the
+    // connection if it is waiting for requests, or write them out if it is
+    // parked in a blocking command.
+    KeyWait *parked = nullptr;
+    client.set_wake_handler([this, client_socket, &parked]
+                            {
+                                if (parked)
+                                {
+                                    parked->flush();
+                                }
+                                else
+                                {
+                                    m_loop.wake(client_socket);
+                                }
+                            });
+    register_client(client);
+    m_loop.watch(client_socket);
+
+    // Releases the connection however the coroutine ends, an exception
+    // included.
+    struct Cleanup
     {
-        if (command.size() == 2)
+        Server &server;
+        Client &client;
+        ~Cleanup()
         {
-            response = "+" + command[1] + "\r\n";
+            server.m_loop.unwatch(client.socket);
+            server.unregister_client(client);
+            close(client.socket);
         }
-        else
-        {
-            response = "-ERR wrong number of arguments for 'ECHO' command\r\n";
-        }
-    }
-    else if (cmd == "SET")
+    } cleanup{*this, client};
+
+    std::vector<std::string_view> args;
+    std::vector<std::string> command;
+
+    while (!client.dropped())
     {
-        if (command.size() >= 3)
+        if (client.blocked)
         {
-            // Handle optional expiry parameters
-            std::optional<std::chrono::milliseconds> expire_time = std::nullopt;
-            if (command.size() > 3)
+            KeyWait wait(*this, client);
+            parked = &wait;
+            co_await wait;
+            parked = nullptr;
+            if (m_shutdown)
             {
-                // Process options
-                for (size_t i = 3; i < command.size(); i += 2)
+                break;
+            }
+            if (!receive_pending(client))
+            {
+                // Hung up while blocked. It is off the wait queues now; pass
+                // on a wake-up that may have been meant for it.
+                for (const auto &key : client.blocked->keys)
                 {
-                    std::string option = command[i];
-                    if (option == "EX" && i + 1 < command.size())
-                    {
-                        int seconds = std::stoi(command[i + 1]);
-                        expire_time = std::chrono::seconds(seconds);
-                    }
-                    else if (option == "PX" && i + 1 < command.size())
-                    {
-                        int milliseconds = std::stoi(command[i + 1]);
-                        expire_time = std::chrono::milliseconds(milliseconds);
-                    }
-                    else
-                    {
-                        response = "-ERR syntax error\r\n";
-                        break;
-                    }
+                    wake_blocked(key);
                 }
+                break;
             }
-            if (response.empty())
+            // run the blocking command again; it either completes or blocks anew
+            execute_command(client, command);
+        }
+
+        try
+        {
+            RESPParser parser(client.query);
+            while (!client.blocked && !client.closing && parser.try_next_command(args))
             {
-                m_data_store.set(command[1], command[2], expire_time);
-                response = "+OK\r\n";
+                command.assign(args.begin(), args.end());
+                execute_command(client, command);
             }
+            // remove the processed part from the buffer
+            client.query.erase(0, parser.consumed());
         }
-        else
+        catch (const std::exception &e)
+        {
+            // only a malformed request gets here; command errors were replied to
+            RESPWriter(client.output, client.protocol()).error(std::string("ERR Protocol error: ") + e.what());
+            client.closing = true;
+        }
+
+        // replies to a whole pipeline go out in one write
+        WriteResult result;
+        while ((result = write_output(client)) == WriteResult::Blocked)
+        {
+            co_await m_loop.writable(client_socket);
+        }
+        if (result == WriteResult::Failed || client.closing)
+        {
+            break;
+        }
+        if (client.blocked)
+        {
+            continue;
+        }
+
+        ssize_t bytes_received = recv(client_socket, m_read_buffer.data(), m_read_buffer.size(), 0);
+        if (bytes_received > 0)
+        {
+            client.query.append(m_read_buffer.data(), bytes_received);
+        }
+        else if (bytes_received == 0)
+        {
+            break;
+        }
+        else if (errno == EAGAIN || errno == EWOULDBLOCK)
         {
-            response = "-ERR wrong number of arguments for 'SET' command\r\n";
+            co_await m_loop.readable(client_socket);
+        }
+        else if (errno != EINTR)
+        {
+            break;
         }
     }
-    else if (cmd == "GET")
+}
+
+bool Server::receive_pending(Client &client)
+{
+    while (true)
     {
-        if (command.size() == 2)
+        ssize_t bytes_received = recv(client.socket, m_read_buffer.data(), m_read_buffer.size(), 0);
+        if (bytes_received > 0)
         {
-            std::string value = m_data_store.get(command[1]);
-            if (!value.empty())
-            {
-                response = "$" + std::to_string(value.size()) + "\r\n" + value + "\r\n";
-            }
-            else
-            {
-                response = "$-1\r\n"; // null bulk reply
-            }
+            client.query.append(m_read_buffer.data(), bytes_received);
         }
-        else
+        else if (bytes_received == 0)
         {
-            response = "-ERR wrong number of arguments for 'GET' command\r\n";
+            return false;
+        }
+        else if (errno != EINTR)
+        {
+            return errno == EAGAIN || errno == EWOULDBLOCK;
         }
     }
-    else if (cmd == "EXISTS")
+}
+
+Server::KeyWait::KeyWait(Server &server, Client &client) : m_server(server), m_client(client)
+{
+}
+
+void Server::KeyWait::await_suspend(std::coroutine_handle<> handle)
+{
+    m_handle = handle;
+    for (const auto &key : m_client.blocked->keys)
     {
-        if (command.size() == 2)
+        m_server.m_blocked[key].push_back(this);
+    }
+    if (m_client.blocked->deadline)
+    {
+        m_timer = m_server.m_loop.add_timer(*m_client.blocked->deadline, [this]
+                                            {
+                                                m_timer.reset();
+                                                resume();
+                                            });
+    }
+    // the client may hang up meanwhile, or send more requests
+    m_server.m_loop.on_readable(m_client.socket, [this]
+                                { resume(); });
+}
+
+void Server::KeyWait::await_resume()
+{
+    for (const auto &key : m_client.blocked->keys)
+    {
+        auto it = m_server.m_blocked.find(key);
+        if (it == m_server.m_blocked.end())
         {
-            bool exists = m_data_store.exists(command[1]);
-            response = ":" + std::to_string(exists ? 1 : 0) + "\r\n";
+            continue;
         }
-        else
+        auto &waiters = it->second;
+        waiters.erase(std::remove(waiters.begin(), waiters.end(), this), waiters.end());
+        if (waiters.empty())
         {
-            response = "-ERR wrong number of arguments for 'EXISTS' command\r\n";
+            m_server.m_blocked.erase(it);
         }
     }
-    else if (cmd == "DEL")
+    if (m_timer)
     {
-        if (command.size() >= 2)
+        m_server.m_loop.cancel_timer(*m_timer);
+    }
+    m_server.m_loop.cancel_on_readable(m_client.socket);
+    m_server.m_loop.cancel_on_writable(m_client.socket);
+}
+
+bool Server::KeyWait::resume()
+{
+    if (m_woken)
+    {
+        return false;
+    }
+    m_woken = true;
+    m_server.m_loop.post(m_handle);
+    return true;
+}
+
+void Server::KeyWait::flush()
+{
+    // A failed write shows up as a hangup, which resumes the connection.
+    if (m_server.write_output(m_client) == WriteResult::Blocked)
+    {
+        m_server.m_loop.on_writable(m_client.socket, [this]
+                                    { flush(); });
+    }
+}
+
+void Server::wake_blocked(const std::string &key)
+{
+    auto it = m_blocked.find(key);
+    if (it == m_blocked.end())
+    {
+        return;
+    }
+    // One waiter per change, oldest first; it retries the pop and blocks
+    // again if somebody else got there first.
+    for (KeyWait *waiter : it->second)
+    {
+        if (waiter->resume())
         {
-            int count = 0;
-            for (size_t i = 1; i < command.size(); i++)
+            break;
+        }
+    }
+}
+
+void Server::serve_threaded_io()
+{
+    // Every command now runs on this thread, so the store can skip its lock.
+    m_data_store.set_single_threaded(true);
+    IOThreadPool pool(static_cast<size_t>(m_io_threads));
+
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0)
+    {
+        std::cerr << "Failed to create epoll instance" << std::endl;
+        return;
+    }
+    fcntl(m_server_socket, F_SETFL, fcntl(m_server_socket, F_GETFL) | O_NONBLOCK);
+    epoll_event listen_event{};
+    listen_event.events = EPOLLIN;
+    listen_event.data.fd = m_server_socket;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, m_server_socket, &listen_event);
+
+    // Clients by socket and by wake fd; the loop owns them.
+    std::unordered_map<int, std::unique_ptr<Client>> clients;
+    std::unordered_map<int, Client *> wake_fds;
+    std::vector<Client *> readable;
+    std::vector<Client *> writable;
+    std::vector<WriteResult> results;
+    epoll_event events[1024];
+    auto last_cron = std::chrono::steady_clock::now();
+
+    auto close_client = [&](Client &client)
+    {
+        unregister_client(client);
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, client.socket, nullptr);
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, client.wake_fd(), nullptr);
+        wake_fds.erase(client.wake_fd());
+        int socket = client.socket;
+        clients.erase(socket); // destroys the client
+        close(socket);
+    };
+
+    auto queue_write = [&](Client &client)
+    {
+        if (!client.write_queued)
+        {
+            client.write_queued = true;
+            writable.push_back(&client);
+        }
+    };
+
+    while (!m_shutdown)
+    {
+        int n = epoll_wait(epoll_fd, events, 1024, 100);
+        if (n < 0)
+        {
+            if (errno == EINTR)
             {
-                if (m_data_store.del(command[i]))
-                {
-                    count++;
-                }
+                continue;
             }
-            response = ":" + std::to_string(count) + "\r\n";
+            std::cerr << "Epoll error" << std::endl;
+            break;
         }
-        else
+
+        readable.clear();
+        writable.clear();
+        for (int i = 0; i < n; i++)
         {
-            response = "-ERR wrong number of arguments for 'DEL' command\r\n";
+            int fd = events[i].data.fd;
+            if (fd == m_server_socket)
+            {
+                int client_socket;
+                while ((client_socket = accept4(m_server_socket, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0)
+                {
+                    auto client = std::make_unique<Client>(m_next_client_id++, client_socket);
+                    epoll_event event{};
+                    event.events = EPOLLIN;
+                    event.data.fd = client_socket;
+                    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client_socket, &event);
+                    event.data.fd = client->wake_fd();
+                    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client->wake_fd(), &event);
+                    wake_fds[client->wake_fd()] = client.get();
+                    register_client(*client);
+                    clients.emplace(client_socket, std::move(client));
+                }
+                continue;
+            }
+
+            auto wake = wake_fds.find(fd);
+            if (wake != wake_fds.end())
+            {
+                wake->second->clear_wake();
+                queue_write(*wake->second);
+                continue;
+            }
+
+            auto it = clients.find(fd);
+            if (it == clients.end())
+            {
+                continue;
+            }
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+            {
+                readable.push_back(it->second.get());
+            }
+            if (events[i].events & EPOLLOUT)
+            {
+                queue_write(*it->second);
+            }
         }
-    }
-    else if (cmd == "INCR")
-    {
-        if (command.size() == 2)
+
+        // Read and parse in parallel...
+        pool.run(readable.size(), [&](size_t i)
+                 { read_commands(*readable[i]); });
+
+        // ...execute on this thread only...
+        for (Client *client : readable)
         {
-            try
+            for (const auto &command : client->commands)
             {
-                int value = m_data_store.incr(command[1]);
-                response = ":" + std::to_string(value) + "\r\n";
+                bool closing = client->closing;
+                execute_command(*client, command);
+                if (client->closing && !closing)
+                {
+                    break; // QUIT: nothing after it runs
+                }
             }
-            catch (const std::exception &e)
+            client->commands.clear();
+            if (!client->protocol_error.empty())
             {
-                response = "-ERR " + std::string(e.what()) + "\r\n";
+                RESPWriter(client->output, client->protocol()).error(client->protocol_error);
             }
+            queue_write(*client);
         }
-        else
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_cron >= kCronInterval)
         {
-            response = "-ERR wrong number of arguments for 'INCR' command\r\n";
+            m_data_store.run_tiering();
+            last_cron = now;
         }
-    }
-    else if (cmd == "DECR")
-    {
-        if (command.size() == 2)
+
+        // ...and write the replies in parallel.
+        results.assign(writable.size(), WriteResult::Done);
+        pool.run(writable.size(), [&](size_t i)
+                 { results[i] = write_output(*writable[i]); });
+
+        for (size_t i = 0; i < writable.size(); i++)
         {
-            try
+            Client &client = *writable[i];
+            client.write_queued = false;
+            if (results[i] == WriteResult::Failed || client.closing || client.dropped())
             {
-                int value = m_data_store.decr(command[1]);
-                response = ":" + std::to_string(value) + "\r\n";
+                close_client(client);
+                continue;
             }
-            catch (const std::exception &e)
+            // Only ask for writability while there is a backlog.
+            bool blocked = results[i] == WriteResult::Blocked;
+            if (blocked != client.write_blocked)
             {
-                response = "-ERR " + std::string(e.what()) + "\r\n";
+                client.write_blocked = blocked;
+                epoll_event event{};
+                event.events = EPOLLIN | (blocked ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+                event.data.fd = client.socket;
+                epoll_ctl(epoll_fd, EPOLL_CTL_MOD, client.socket, &event);
             }
         }
-        else
-        {
-            response = "-ERR wrong number of arguments for 'DECR' command\r\n";
-        }
     }
-    else
+
+    while (!clients.empty())
     {
-        response = "-ERR unknown command '" + command[0] + "'\r\n";
+        close_client(*clients.begin()->second);
     }
+    close(epoll_fd);
+    m_data_store.set_single_threaded(false);
+}
 
-    send(client_socket, response.c_str(), response.size(), 0);
+void Server::read_commands(Client &client)
+{
+    char buffer[16 * 1024];
+    while (true)
+    {
+        ssize_t bytes_received = recv(client.socket, buffer, sizeof(buffer), 0);
+        if (bytes_received > 0)
+        {
+            client.query.append(buffer, bytes_received);
+            if (static_cast<size_t>(bytes_received) < sizeof(buffer))
+            {
+                break;
+            }
+        }
+        else if (bytes_received == 0)
+        {
+            client.closing = true;
+            break;
+        }
+        else if (errno != EINTR)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                client.closing = true;
+            }
+            break;
+        }
+    }
+
+    try
+    {
+        thread_local std::vector<std::string_view> args;
+        RESPParser parser(client.query);
+        while (parser.try_next_command(args))
+        {
+            client.commands.emplace_back(args.begin(), args.end());
+        }
+        client.query.erase(0, parser.consumed());
+    }
+    catch (const std::exception &e)
+    {
+        // Commands parsed before the error still run; then the reply is
+        // flushed and the connection closed.
+        client.protocol_error = std::string("ERR Protocol error: ") + e.what();
+        client.closing = true;
+    }
+}
+
+Server::WriteResult Server::write_output(Client &client)
+{
+    constexpr size_t kMaxIov = 64;
+    iovec iov[kMaxIov];
+
+    // Pushed messages are shared with every other receiver; they are written
+    // straight from the shared buffers rather than copied into `output`.
+    auto &pushed = client.take_pushed();
+
+    while (!client.output.empty() || !pushed.empty())
+    {
+        size_t count = 0;
+        if (!client.output.empty())
+        {
+            iov[count++] = {client.output.data(), client.output.size()};
+        }
+        for (size_t i = 0; i < pushed.size() && count < kMaxIov; i++)
+        {
+            size_t skip = i == 0 ? client.push_offset : 0;
+            iov[count++] = {const_cast<char *>(pushed[i]->data()) + skip, pushed[i]->size() - skip};
+        }
+
+        msghdr msg{};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = count;
+        ssize_t n = sendmsg(client.socket, &msg, MSG_NOSIGNAL);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return errno == EAGAIN || errno == EWOULDBLOCK ? WriteResult::Blocked : WriteResult::Failed;
+        }
+
+        size_t written = static_cast<size_t>(n);
+        if (!client.output.empty())
+        {
+            size_t consumed = std::min(written, client.output.size());
+            // erasing everything keeps the capacity, so steady state replies do not allocate
+            client.output.erase(0, consumed);
+            written -= consumed;
+        }
+        while (written > 0)
+        {
+            size_t remaining = pushed.front()->size() - client.push_offset;
+            if (written < remaining)
+            {
+                client.push_offset += written;
+                break;
+            }
+            written -= remaining;
+            client.release_pushed(pushed.front()->size());
+            pushed.pop_front();
+            client.push_offset = 0;
+        }
+    }
+    return WriteResult::Done;
+}
+
+void Server::register_client(Client &client)
+{
+    std::lock_guard<std::mutex> lock(m_clients_mutex);
+    m_clients[client.id] = &client;
+}
+
+void Server::unregister_client(Client &client)
+{
+    // nothing may deliver to the client once its socket is closed
+    {
+        std::lock_guard<std::mutex> lock(m_clients_mutex);
+        m_clients.erase(client.id);
+        m_tracker.forget(client.id, client);
+    }
+    m_pubsub.unsubscribe_all(client);
+}
+
+void Server::execute_command(Client &client, const std::vector<std::string> &command)
+{
+    size_t reply_start = client.output.size();
+    try
+    {
+        process_command(client, command);
+    }
+    catch (const std::exception &e)
+    {
+        // a failed command replies with the error alone, and never leaves
+        // the client blocked
+        client.output.resize(reply_start);
+        client.blocked.reset();
+        std::string message = e.what();
+        bool has_code = message.rfind("ERR ", 0) == 0 || message.rfind("WRONGTYPE ", 0) == 0;
+        RESPWriter(client.output, client.protocol()).error(has_code ? message : "ERR " + message);
+    }
+}
+
+void Server::process_command(Client &client, const std::vector<std::string> &command)
+{
+    if (command.empty())
+    {
+        return;
+    }
+
+    std::string cmd = command[0];
+    std::transform(cmd.begin(), cmd.end(), cmd.begin(), ::toupper);
+
+    RESPWriter reply(client.output, client.protocol());
+
+    // RESP2 has no out-of-band pushes, so a subscribed connection is limited
+    // to commands whose replies cannot be confused with messages.
+    if (client.protocol() < 3 && m_pubsub.subscription_count(client) > 0 &&
+        cmd != "SUBSCRIBE" && cmd != "UNSUBSCRIBE" && cmd != "PSUBSCRIBE" &&
+        cmd != "PUNSUBSCRIBE" && cmd != "PING" && cmd != "QUIT")
+    {
+        reply.error("ERR Can't execute '" + command[0] +
+                    "': only (P)SUBSCRIBE / (P)UNSUBSCRIBE / PING / QUIT are allowed in this context");
+        return;
+    }
+
+    if (cmd == "PING")
+    {
+        if (command.size() <= 2 && client.protocol() < 3 && m_pubsub.subscription_count(client) > 0)
+        {
+            reply.array_header(2);
+            reply.bulk_string("pong");
+            reply.bulk_string(command.size() == 2 ? command[1] : "");
+        }
+        else if (command.size() == 1)
+        {
+            reply.raw(shared_reply::pong);
+        }
+        else if (command.size() == 2)
+        {
+            reply.bulk_string(command[1]);
+        }
+        else
+        {
+            reply.error("ERR wrong number of arguments for 'PING' command");
+        }
+    }
+    else if (cmd == "QUIT")
+    {
+        // the connection closes once the reply is written
+        reply.ok();
+        client.closing = true;
+    }
+    else if (cmd == "ECHO")
+    {
+        if (command.size() == 2)
+        {
+            reply.bulk_string(command[1]);
+        }
+        else
+        {
+            reply.error("ERR wrong number of arguments for 'ECHO' command");
+        }
+    }
+    else if (cmd == "HELLO")
+    {
+        int protocol = client.protocol();
+        if (command.size() >= 2)
+        {
+            if (command[1] == "2")
+            {
+                protocol = 2;
+            }
+            else if (command[1] == "3")
+            {
+                protocol = 3;
+            }
+            else
+            {
+                reply.error("NOPROTO unsupported protocol version");
+                return;
+            }
+        }
+        client.set_protocol(protocol);
+
+        RESPWriter hello(client.output, protocol);
+        hello.map_header(7);
+        hello.bulk_string("server");
+        hello.bulk_string("redis-lite");
+        hello.bulk_string("version");
+        hello.bulk_string("0.1.0");
+        hello.bulk_string("proto");
+        hello.integer(protocol);
+        hello.bulk_string("id");
+        hello.integer(static_cast<int64_t>(client.id));
+        hello.bulk_string("mode");
+        hello.bulk_string("standalone");
+        hello.bulk_string("role");
+        hello.bulk_string("master");
+        hello.bulk_string("modules");
+        hello.raw(shared_reply::empty_array);
+    }
+    else if (cmd == "SET")
+    {
+        if (command.size() >= 3)
+        {
+            // Handle optional expiry parameters
+            std::optional<std::chrono::milliseconds> expire_time = std::nullopt;
+            bool syntax_error = false;
+            if (command.size() > 3)
+            {
+                // Process options
+                for (size_t i = 3; i < command.size(); i += 2)
+                {
+                    std::string option = command[i];
+                    if ((option == "EX" || option == "PX") && i + 1 < command.size())
+                    {
+                        int64_t amount;
+                        try
+                        {
+                            size_t parsed;
+                            amount = std::stoll(command[i + 1], &parsed);
+                            if (parsed != command[i + 1].size())
+                            {
+                                throw std::invalid_argument("expire");
+                            }
+                        }
+                        catch (const std::exception &)
+                        {
+                            reply.error("ERR value is not an integer or out of range");
+                            return;
+                        }
+                        // about a century, so that the deadline cannot overflow the clock
+                        constexpr int64_t kMaxExpireMilliseconds = int64_t{1} << 41;
+                        int64_t milliseconds = option == "EX" ? amount * 1000 : amount;
+                        if (amount <= 0 || amount > kMaxExpireMilliseconds || milliseconds > kMaxExpireMilliseconds)
+                        {
+                            reply.error("ERR invalid expire time in 'set' command");
+                            return;
+                        }
+                        expire_time = std::chrono::milliseconds(milliseconds);
+                    }
+                    else
+                    {
+                        syntax_error = true;
+                        break;
+                    }
+                }
+            }
+            if (syntax_error)
+            {
+                reply.error("ERR syntax error");
+            }
+            else
+            {
+                m_data_store.set(command[1], command[2], expire_time);
+                reply.ok();
+            }
+        }
+        else
+        {
+            reply.error("ERR wrong number of arguments for 'SET' command");
+        }
+    }
+    else if (cmd == "GET")
+    {
+        if (command.size() == 2)
+        {
+            if (client.tracking)
+            {
+                m_tracker.remember(client.id, command[1]);
+            }
+            std::string value = m_data_store.get(command[1]);
+            if (!value.empty())
+            {
+                reply.bulk_string(value);
+            }
+            else
+            {
+                reply.null();
+            }
+        }
+        else
+        {
+            reply.error("ERR wrong number of arguments for 'GET' command");
+        }
+    }
+    else if (cmd == "EXISTS")
+    {
+        if (command.size() == 2)
+        {
+            if (client.tracking)
+            {
+                m_tracker.remember(client.id, command[1]);
+            }
+            bool exists = m_data_store.exists(command[1]);
+            reply.integer(exists ? 1 : 0);
+        }
+        else
+        {
+            reply.error("ERR wrong number of arguments for 'EXISTS' command");
+        }
+    }
+    else if (cmd == "DEL")
+    {
+        if (command.size() >= 2)
+        {
+            int count = 0;
+            for (size_t i = 1; i < command.size(); i++)
+            {
+                if (m_data_store.del(command[i]))
+                {
+                    count++;
+                }
+            }
+            reply.integer(count);
+        }
+        else
+        {
+            reply.error("ERR wrong number of arguments for 'DEL' command");
+        }
+    }
+    else if (cmd == "UNLINK")
+    {
+        if (command.size() >= 2)
+        {
+            int count = 0;
+            for (size_t i = 1; i < command.size(); i++)
+            {
+                if (m_data_store.unlink(command[i]))
+                {
+                    count++;
+                }
+            }
+            reply.integer(count);
+        }
+        else
+        {
+            reply.error("ERR wrong number of arguments for 'UNLINK' command");
+        }
+    }
+    else if (cmd == "FLUSHALL" || cmd == "FLUSHDB")
+    {
+        std::string mode = command.size() == 2 ? command[1] : "SYNC";
+        std::transform(mode.begin(), mode.end(), mode.begin(), ::toupper);
+        if (command.size() <= 2 && (mode == "SYNC" || mode == "ASYNC"))
+        {
+            m_data_store.flushall(mode == "ASYNC");
+            reply.ok();
+        }
+        else
+        {
+            reply.error("ERR syntax error");
+        }
+    }
+    else if (cmd == "INFO")
+    {
+        if (command.size() <= 2)
+        {
+            std::string section = command.size() == 2 ? command[1] : "all";
+            std::transform(section.begin(), section.end(), section.begin(), ::tolower);
+            reply.bulk_string(info(section));
+        }
+        else
+        {
+            reply.error("ERR wrong number of arguments for 'INFO' command");
+        }
+    }
+    else if (cmd == "HOTKEYS" || cmd == "BIGKEYS")
+    {
+        if (command.size() <= 2)
+        {
+            size_t count = 10;
+            try
+            {
+                if (command.size() == 2)
+                {
+                    count = std::stoul(command[1]);
+                }
+            }
+            catch (const std::exception &)
+            {
+                reply.error("ERR value is not an integer or out of range");
+                return;
+            }
+
+            if (cmd == "HOTKEYS")
+            {
+                auto keys = m_data_store.hot_keys(count);
+                reply.array_header(keys.size());
+                for (const auto &hot : keys)
+                {
+                    reply.array_header(2);
+                    reply.bulk_string(hot.key);
+                    reply.integer(static_cast<int64_t>(hot.accesses));
+                }
+            }
+            else
+            {
+                auto keys = m_data_store.big_keys(count);
+                reply.array_header(keys.size());
+                for (const auto &big : keys)
+                {
+                    reply.array_header(3);
+                    reply.bulk_string(big.key);
+                    reply.bulk_string(big.type);
+                    reply.integer(static_cast<int64_t>(big.size));
+                }
+            }
+        }
+        else
+        {
+            reply.error("ERR wrong number of arguments for '" + command[0] + "' command");
+        }
+    }
+    else if (cmd == "INCR")
+    {
+        if (command.size() == 2)
+        {
+            try
+            {
+                int value = m_data_store.incr(command[1]);
+                reply.integer(value);
+            }
+            catch (const std::exception &e)
+            {
+                reply.error("ERR " + std::string(e.what()));
+            }
+        }
+        else
+        {
+            reply.error("ERR wrong number of arguments for 'INCR' command");
+        }
+    }
+    else if (cmd == "DECR")
+    {
+        if (command.size() == 2)
+        {
+            try
+            {
+                int value = m_data_store.decr(command[1]);
+                reply.integer(value);
+            }
+            catch (const std::exception &e)
+            {
+                reply.error("ERR " + std::string(e.what()));
+            }
+        }
+        else
+        {
+            reply.error("ERR wrong number of arguments for 'DECR' command");
+        }
+    }
+    else if (cmd == "LPUSH" || cmd == "RPUSH")
+    {
+        if (command.size() >= 3)
+        {
+            int length = 0;
+            for (size_t i = 2; i < command.size(); i++)
+            {
+                length = cmd == "LPUSH" ? m_data_store.lpush(command[1], command[i])
+                                        : m_data_store.rpush(command[1], command[i]);
+            }
+            reply.integer(length);
+        }
+        else
+        {
+            reply.error("ERR wrong number of arguments for '" + command[0] + "' command");
+        }
+    }
+    else if (cmd == "PFADD")
+    {
+        if (command.size() >= 2)
+        {
+            try
+            {
+                std::vector<std::string> elements(command.begin() + 2, command.end());
+                reply.integer(m_data_store.pfadd(command[1], elements) ? 1 : 0);
+            }
+            catch (const std::exception &e)
+            {
+                reply.error(e.what());
+            }
+        }
+        else
+        {
+            reply.error("ERR wrong number of arguments for 'PFADD' command");
+        }
+    }
+    else if (cmd == "PFCOUNT")
+    {
+        if (command.size() >= 2)
+        {
+            std::vector<std::string> keys(command.begin() + 1, command.end());
+            if (client.tracking)
+            {
+                for (const auto &key : keys)
+                {
+                    m_tracker.remember(client.id, key);
+                }
+            }
+            try
+            {
+                reply.integer(static_cast<int64_t>(m_data_store.pfcount(keys)));
+            }
+            catch (const std::exception &e)
+            {
+                reply.error(e.what());
+            }
+        }
+        else
+        {
+            reply.error("ERR wrong number of arguments for 'PFCOUNT' command");
+        }
+    }
+    else if (cmd == "PFMERGE")
+    {
+        if (command.size() >= 2)
+        {
+            try
+            {
+                std::vector<std::string> sources(command.begin() + 2, command.end());
+                m_data_store.pfmerge(command[1], sources);
+                reply.ok();
+            }
+            catch (const std::exception &e)
+            {
+                reply.error(e.what());
+            }
+        }
+        else
+        {
+            reply.error("ERR wrong number of arguments for 'PFMERGE' command");
+        }
+    }
+    else if (cmd == "SETBIT" || cmd == "GETBIT" || cmd == "BITCOUNT" || cmd == "BITPOS" || cmd == "BITOP")
+    {
+        bitmap_command(client, command, cmd, reply);
+    }
+    else if (cmd == "LPOP" || cmd == "RPOP")
+    {
+        if (command.size() == 2)
+        {
+            auto value = cmd == "LPOP" ? m_data_store.lpop(command[1]) : m_data_store.rpop(command[1]);
+            if (value)
+            {
+                reply.bulk_string(*value);
+            }
+            else
+            {
+                reply.null();
+            }
+        }
+        else
+        {
+            reply.error("ERR wrong number of arguments for '" + command[0] + "' command");
+        }
+    }
+    else if (cmd == "BLPOP" || cmd == "BRPOP")
+    {
+        blocking_pop(client, command, cmd == "BLPOP", reply);
+    }
+    else if (cmd == "LRANGE")
+    {
+        if (command.size() == 4)
+        {
+            if (client.tracking)
+            {
+                m_tracker.remember(client.id, command[1]);
+            }
+            try
+            {
+                auto values = m_data_store.lrange(command[1], std::stoi(command[2]), std::stoi(command[3]));
+                reply.array_header(values.size());
+                for (const auto &value : values)
+                {
+                    reply.bulk_string(value);
+                }
+            }
+            catch (const std::exception &)
+            {
+                reply.error("ERR value is not an integer or out of range");
+            }
+        }
+        else
+        {
+            reply.error("ERR wrong number of arguments for 'LRANGE' command");
+        }
+    }
+    else if (cmd == "CLIENT")
+    {
+        client_command(client, command, reply);
+    }
+    else if (cmd == "SUBSCRIBE" || cmd == "PSUBSCRIBE")
+    {
+        if (command.size() >= 2)
+        {
+            bool pattern = cmd == "PSUBSCRIBE";
+            for (size_t i = 1; i < command.size(); i++)
+            {
+                size_t count = pattern ? m_pubsub.psubscribe(client, command[i])
+                                       : m_pubsub.subscribe(client, command[i]);
+                reply.push_header(3);
+                reply.bulk_string(pattern ? "psubscribe" : "subscribe");
+                reply.bulk_string(command[i]);
+                reply.integer(static_cast<int64_t>(count));
+            }
+        }
+        else
+        {
+            reply.error("ERR wrong number of arguments for '" + command[0] + "' command");
+        }
+    }
+    else if (cmd == "UNSUBSCRIBE" || cmd == "PUNSUBSCRIBE")
+    {
+        bool pattern = cmd == "PUNSUBSCRIBE";
+        std::vector<std::string> targets(command.begin() + 1, command.end());
+        if (targets.empty())
+        {
+            targets = pattern ? m_pubsub.patterns(client) : m_pubsub.channels(client);
+        }
+
+        const char *kind = pattern ? "punsubscribe" : "unsubscribe";
+        if (targets.empty())
+        {
+            reply.push_header(3);
+            reply.bulk_string(kind);
+            reply.null();
+            reply.integer(static_cast<int64_t>(m_pubsub.subscription_count(client)));
+        }
+        for (const auto &target : targets)
+        {
+            size_t count = pattern ? m_pubsub.punsubscribe(client, target)
+                                   : m_pubsub.unsubscribe(client, target);
+            reply.push_header(3);
+            reply.bulk_string(kind);
+            reply.bulk_string(target);
+            reply.integer(static_cast<int64_t>(count));
+        }
+    }
+    else if (cmd == "PUBLISH")
+    {
+        if (command.size() == 3)
+        {
+            reply.integer(static_cast<int64_t>(m_pubsub.publish(command[1], command[2])));
+        }
+        else
+        {
+            reply.error("ERR wrong number of arguments for 'PUBLISH' command");
+        }
+    }
+    else
+    {
+        reply.error("ERR unknown command '" + command[0] + "'");
+    }
+}
+
+void Server::blocking_pop(Client &client, const std::vector<std::string> &command, bool left, RESPWriter &reply)
+{
+    if (command.size() < 3)
+    {
+        reply.error("ERR wrong number of arguments for '" + command[0] + "' command");
+        return;
+    }
+
+    double timeout;
+    try
+    {
+        size_t parsed;
+        timeout = std::stod(command.back(), &parsed);
+        if (parsed != command.back().size())
+        {
+            throw std::invalid_argument("timeout");
+        }
+    }
+    catch (const std::exception &)
+    {
+        reply.error("ERR timeout is not a float or out of range");
+        return;
+    }
+    if (timeout < 0)
+    {
+        reply.error("ERR timeout is negative");
+        return;
+    }
+
+    for (size_t i = 1; i + 1 < command.size(); i++)
+    {
+        auto value = left ? m_data_store.lpop(command[i]) : m_data_store.rpop(command[i]);
+        if (value)
+        {
+            client.blocked.reset();
+            reply.array_header(2);
+            reply.bulk_string(command[i]);
+            reply.bulk_string(*value);
+            return;
+        }
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (client.blocked)
+    {
+        // woken up again, by a change to one of the keys or the deadline
+        if (client.blocked->deadline && now >= *client.blocked->deadline)
+        {
+            client.blocked.reset();
+            reply.null_array();
+        }
+        return;
+    }
+    if (!m_can_block)
+    {
+        reply.error("ERR blocking commands are not supported with --io-threads");
+        return;
+    }
+
+    // No reply yet: the connection parks until a key changes or time is up.
+    Client::Blocked blocked;
+    blocked.keys.assign(command.begin() + 1, command.end() - 1);
+    if (timeout > 0)
+    {
+        blocked.deadline = now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                     std::chrono::duration<double>(timeout));
+    }
+    client.blocked = std::move(blocked);
+}
+
+void Server::bitmap_command(Client &client, const std::vector<std::string> &command, const std::string &cmd,
+                            RESPWriter &reply)
+{
+    auto parse_integer = [](const std::string &text, int64_t &value)
+    {
+        try
+        {
+            size_t parsed;
+            value = std::stoll(text, &parsed);
+            return parsed == text.size();
+        }
+        catch (const std::exception &)
+        {
+            return false;
+        }
+    };
+    // [start [end [BYTE|BIT]]], starting at command[first]
+    auto parse_range = [&](size_t first, DataStore::BitRange &range)
+    {
+        int64_t value;
+        if (command.size() > first)
+        {
+            if (!parse_integer(command[first], value))
+            {
+                reply.error("ERR value is not an integer or out of range");
+                return false;
+            }
+            range.start = value;
+        }
+        if (command.size() > first + 1)
+        {
+            if (!parse_integer(command[first + 1], value))
+            {
+                reply.error("ERR value is not an integer or out of range");
+                return false;
+            }
+            range.end = value;
+        }
+        if (command.size() > first + 2)
+        {
+            std::string unit = command[first + 2];
+            std::transform(unit.begin(), unit.end(), unit.begin(), ::toupper);
+            if (command.size() > first + 3 || (unit != "BYTE" && unit != "BIT"))
+            {
+                reply.error("ERR syntax error");
+                return false;
+            }
+            range.bits = unit == "BIT";
+        }
+        return true;
+    };
+    auto remember = [&](const std::string &key)
+    {
+        if (client.tracking)
+        {
+            m_tracker.remember(client.id, key);
+        }
+    };
+
+    try
+    {
+        if (cmd == "SETBIT" || cmd == "GETBIT")
+        {
+            if (command.size() != (cmd == "SETBIT" ? 4u : 3u))
+            {
+                reply.error("ERR wrong number of arguments for '" + command[0] + "' command");
+                return;
+            }
+            int64_t offset;
+            if (!parse_integer(command[2], offset) || offset < 0 ||
+                static_cast<uint64_t>(offset) > DataStore::kMaxBitOffset)
+            {
+                reply.error("ERR bit offset is not an integer or out of range");
+                return;
+            }
+            if (cmd == "GETBIT")
+            {
+                remember(command[1]);
+                reply.integer(m_data_store.getbit(command[1], static_cast<uint64_t>(offset)));
+                return;
+            }
+            if (command[3] != "0" && command[3] != "1")
+            {
+                reply.error("ERR bit is not an integer or out of range");
+                return;
+            }
+            reply.integer(m_data_store.setbit(command[1], static_cast<uint64_t>(offset), command[3] == "1"));
+        }
+        else if (cmd == "BITCOUNT")
+        {
+            if (command.size() < 2)
+            {
+                reply.error("ERR wrong number of arguments for '" + command[0] + "' command");
+                return;
+            }
+            DataStore::BitRange range;
+            if (command.size() == 3)
+            {
+                // a start needs an end
+                reply.error("ERR syntax error");
+                return;
+            }
+            if (!parse_range(2, range))
+            {
+                return;
+            }
+            remember(command[1]);
+            reply.integer(static_cast<int64_t>(m_data_store.bitcount(command[1], range)));
+        }
+        else if (cmd == "BITPOS")
+        {
+            if (command.size() < 3)
+            {
+                reply.error("ERR wrong number of arguments for '" + command[0] + "' command");
+                return;
+            }
+            if (command[2] != "0" && command[2] != "1")
+            {
+                reply.error("ERR The bit argument must be 1 or 0.");
+                return;
+            }
+            DataStore::BitRange range;
+            if (!parse_range(3, range))
+            {
+                return;
+            }
+            remember(command[1]);
+            reply.integer(m_data_store.bitpos(command[1], command[2] == "1", range));
+        }
+        else
+        {
+            if (command.size() < 4)
+            {
+                reply.error("ERR wrong number of arguments for '" + command[0] + "' command");
+                return;
+            }
+            std::string operation = command[1];
+            std::transform(operation.begin(), operation.end(), operation.begin(), ::toupper);
+            DataStore::BitOp op;
+            if (operation == "AND")
+                op = DataStore::BitOp::And;
+            else if (operation == "OR")
+                op = DataStore::BitOp::Or;
+            else if (operation == "XOR")
+                op = DataStore::BitOp::Xor;
+            else if (operation == "NOT")
+                op = DataStore::BitOp::Not;
+            else
+            {
+                reply.error("ERR syntax error");
+                return;
+            }
+            if (op == DataStore::BitOp::Not && command.size() != 4)
+            {
+                reply.error("ERR BITOP NOT must be called with a single source key.");
+                return;
+            }
+            std::vector<std::string> sources(command.begin() + 3, command.end());
+            reply.integer(static_cast<int64_t>(m_data_store.bitop(op, command[2], sources)));
+        }
+    }
+    catch (const std::exception &e)
+    {
+        reply.error(e.what());
+    }
+}
+
+void Server::client_command(Client &client, const std::vector<std::string> &command, RESPWriter &reply)
+{
+    if (command.size() < 2)
+    {
+        reply.error("ERR wrong number of arguments for 'CLIENT' command");
+        return;
+    }
+
+    std::string subcommand = command[1];
+    std::transform(subcommand.begin(), subcommand.end(), subcommand.begin(), ::toupper);
+
+    if (subcommand == "ID" && command.size() == 2)
+    {
+        reply.integer(static_cast<int64_t>(client.id));
+    }
+    else if (subcommand == "TRACKING" && command.size() >= 3)
+    {
+        std::string mode = command[2];
+        std::transform(mode.begin(), mode.end(), mode.begin(), ::toupper);
+
+        if (mode == "OFF")
+        {
+            m_tracker.disable(client.id);
+            client.tracking = false;
+            reply.ok();
+            return;
+        }
+        if (mode != "ON")
+        {
+            reply.error("ERR syntax error");
+            return;
+        }
+
+        KeyTracker::Options options;
+        std::optional<uint64_t> redirect;
+        for (size_t i = 3; i < command.size(); i++)
+        {
+            std::string option = command[i];
+            std::transform(option.begin(), option.end(), option.begin(), ::toupper);
+            if (option == "BCAST")
+            {
+                options.broadcast = true;
+            }
+            else if (option == "PREFIX" && i + 1 < command.size())
+            {
+                options.prefixes.push_back(command[++i]);
+            }
+            else if (option == "REDIRECT" && i + 1 < command.size())
+            {
+                try
+                {
+                    redirect = std::stoull(command[++i]);
+                }
+                catch (const std::exception &)
+                {
+                    reply.error("ERR value is not an integer or out of range");
+                    return;
+                }
+            }
+            else
+            {
+                reply.error("ERR syntax error");
+                return;
+            }
+        }
+
+        if (!options.broadcast && !options.prefixes.empty())
+        {
+            reply.error("ERR PREFIX option requires BCAST mode to be enabled");
+            return;
+        }
+        if (!redirect && client.protocol() < 3)
+        {
+            reply.error("ERR RESP2 clients need REDIRECT to receive invalidation messages");
+            return;
+        }
+
+        // Held across enable() so the redirect target cannot disconnect in between.
+        std::lock_guard<std::mutex> lock(m_clients_mutex);
+        Subscriber *target = &client;
+        if (redirect)
+        {
+            auto it = m_clients.find(*redirect);
+            if (it == m_clients.end())
+            {
+                reply.error("ERR The client ID you want redirect to does not exist");
+                return;
+            }
+            target = it->second;
+        }
+        m_tracker.enable(client.id, client, *target, options);
+        client.tracking = !options.broadcast;
+        reply.ok();
+    }
+    else
+    {
+        reply.error("ERR unknown subcommand or wrong number of arguments for '" + command[1] + "'");
+    }
+}
+
+std::string Server::info(const std::string &section)
+{
+    bool all = section == "all" || section == "everything" || section == "default";
+    std::string out;
+
+    if (all || section == "server")
+    {
+        out += "# Server\r\n";
+        out += "redis_version:0.1.0\r\n";
+        out += "tcp_port:" + std::to_string(m_port) + "\r\n";
+    }
+    if (all || section == "clients")
+    {
+        std::lock_guard<std::mutex> lock(m_clients_mutex);
+        if (!out.empty())
+        {
+            out += "\r\n";
+        }
+        out += "# Clients\r\n";
+        out += "connected_clients:" + std::to_string(m_clients.size()) + "\r\n";
+    }
+    if (all || section == "memory")
+    {
+        auto lazyfree = m_data_store.lazyfree_stats();
+        if (!out.empty())
+        {
+            out += "\r\n";
+        }
+        out += "# Memory\r\n";
+        out += "lazyfree_pending_objects:" + std::to_string(lazyfree.pending_objects) + "\r\n";
+        out += "lazyfree_pending_bytes:" + std::to_string(lazyfree.pending_bytes) + "\r\n";
+        out += "lazyfreed_objects:" + std::to_string(lazyfree.freed_objects) + "\r\n";
+    }
+    if (all || section == "tiering")
+    {
+        auto tiering = m_data_store.tiering_stats();
+        if (!out.empty())
+        {
+            out += "\r\n";
+        }
+        out += "# Tiering\r\n";
+        out += "tiered_keys:" + std::to_string(tiering.spilled_keys) + "\r\n";
+        out += "tiered_value_bytes:" + std::to_string(tiering.spilled_bytes) + "\r\n";
+        out += "value_log_segments:" + std::to_string(tiering.log.segments) + "\r\n";
+        out += "value_log_disk_bytes:" + std::to_string(tiering.log.disk_bytes) + "\r\n";
+        out += "value_log_live_bytes:" + std::to_string(tiering.log.live_bytes) + "\r\n";
+        out += "value_log_compactions:" + std::to_string(tiering.log.compactions) + "\r\n";
+    }
+    if (all || section == "compression")
+    {
+        auto compression = m_data_store.compression_stats();
+        char ratio[32];
+        std::snprintf(ratio, sizeof(ratio), "%.2f",
+                      compression.output_bytes ? static_cast<double>(compression.input_bytes) / compression.output_bytes : 1.0);
+        if (!out.empty())
+        {
+            out += "\r\n";
+        }
+        out += "# Compression\r\n";
+        out += "compression_threshold:" + std::to_string(compression.threshold) + "\r\n";
+        out += "compressed_values:" + std::to_string(compression.compressed) + "\r\n";
+        out += "incompressible_values:" + std::to_string(compression.incompressible) + "\r\n";
+        out += "compression_input_bytes:" + std::to_string(compression.input_bytes) + "\r\n";
+        out += "compression_output_bytes:" + std::to_string(compression.output_bytes) + "\r\n";
+        out += "compression_ratio:" + std::string(ratio) + "\r\n";
+        out += "compress_time_us:" +
+               std::to_string(std::chrono::duration_cast<std::chrono::microseconds>(compression.compress_time).count()) + "\r\n";
+        out += "decompressions:" + std::to_string(compression.decompressed) + "\r\n";
+        out += "decompress_time_us:" +
+               std::to_string(std::chrono::duration_cast<std::chrono::microseconds>(compression.decompress_time).count()) + "\r\n";
+    }
+    return out;
 }
@@ -0,0 +1,321 @@
+#include <atomic>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <stdexcept>
+#include <unistd.h>
+
+#include "ValueLog.hpp"
+
+namespace
+{
+    // Record layout: key length, value length (both u32), key, value.
+    constexpr size_t kHeaderBytes = 2 * sizeof(uint32_t);
+
+    // Distinguishes the files of logs sharing a directory.
+    std::atomic<uint32_t> g_log_instances{0};
+
+    void pread_all(int fd, char *buffer, size_t length, uint64_t offset)
+    {
+        while (length > 0)
+        {
+            ssize_t n = pread(fd, buffer, length, static_cast<off_t>(offset));
+            if (n <= 0)
+            {
+                if (n < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                throw std::runtime_error("Failed to read from value log");
+            }
+            buffer += n;
+            length -= static_cast<size_t>(n);
+            offset += static_cast<uint64_t>(n);
+        }
+    }
+
+    void pwrite_all(int fd, const char *buffer, size_t length, uint64_t offset)
+    {
+        while (length > 0)
+        {
+            ssize_t n = pwrite(fd, buffer, length, static_cast<off_t>(offset));
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                throw std::runtime_error("Failed to write to value log");
+            }
+            buffer += n;
+            length -= static_cast<size_t>(n);
+            offset += static_cast<uint64_t>(n);
+        }
+    }
+}
+
+ValueLog::Segment::Segment(uint32_t id, std::string path) : id(id), path(std::move(path))
+{
+    fd = open(this->path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Failed to create value log segment " + this->path);
+    }
+}
+
+ValueLog::Segment::~Segment()
+{
+    close(fd);
+    unlink(path.c_str());
+}
+
+ValueLog::ValueLog(const std::string &directory, uint64_t segment_bytes)
+    : m_directory(directory + "/values-" + std::to_string(getpid()) + "-" + std::to_string(g_log_instances++)),
+      m_segment_bytes(segment_bytes)
+{
+    std::filesystem::create_directories(directory);
+}
+
+ValueLog::~ValueLog()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_work_cv.notify_one();
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+    m_segments.clear();
+    m_active.reset();
+    std::error_code error;
+    std::filesystem::remove(m_directory, error);
+}
+
+ValueLog::Location ValueLog::append(std::string_view key, std::string_view value)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return append_locked(key, value);
+}
+
+std::string ValueLog::read(const Location &location) const
+{
+    std::shared_ptr<Segment> segment;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_segments.find(location.segment);
+        if (it == m_segments.end())
+        {
+            throw std::runtime_error("Value log segment is gone");
+        }
+        segment = it->second;
+    }
+    std::string value(location.length, '\0');
+    pread_all(segment->fd, value.data(), value.size(), location.offset);
+    return value;
+}
+
+void ValueLog::release(const Location &location)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_segments.find(location.segment);
+    if (it == m_segments.end())
+    {
+        return;
+    }
+    auto &segment = *it->second;
+    if (segment.dead.insert(location.offset).second)
+    {
+        segment.live_bytes -= location.length;
+        if (segment.sealed)
+        {
+            schedule_compaction();
+        }
+    }
+}
+
+std::vector<ValueLog::Relocation> ValueLog::take_relocations()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (uint32_t id : m_compacted)
+    {
+        m_segments.erase(id);
+    }
+    m_compacted.clear();
+    return std::move(m_relocations);
+}
+
+void ValueLog::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_generation++;
+    // A segment being compacted lives on until the compactor lets go of it.
+    m_segments.clear();
+    m_active.reset();
+    m_relocations.clear();
+    m_compacted.clear();
+}
+
+ValueLog::Stats ValueLog::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Stats stats{m_segments.size(), 0, 0, m_compactions};
+    for (const auto &[id, segment] : m_segments)
+    {
+        stats.disk_bytes += segment->size;
+        stats.live_bytes += segment->live_bytes;
+    }
+    return stats;
+}
+
+void ValueLog::wait_compacted()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle_cv.wait(lock, [this]
+                   { return !m_busy && !compaction_candidate(); });
+}
+
+std::shared_ptr<ValueLog::Segment> ValueLog::open_segment()
+{
+    if (m_next_segment == 0)
+    {
+        std::filesystem::create_directories(m_directory);
+    }
+    uint32_t id = m_next_segment++;
+    auto segment = std::make_shared<Segment>(id, m_directory + "/" + std::to_string(id) + ".log");
+    m_segments[id] = segment;
+    return segment;
+}
+
+ValueLog::Location ValueLog::append_locked(std::string_view key, std::string_view value)
+{
+    size_t record_bytes = kHeaderBytes + key.size() + value.size();
+    if (!m_active || (m_active->size > 0 && m_active->size + record_bytes > m_segment_bytes))
+    {
+        if (m_active)
+        {
+            m_active->sealed = true;
+            schedule_compaction();
+        }
+        m_active = open_segment();
+    }
+
+    std::string record(record_bytes, '\0');
+    uint32_t lengths[2] = {static_cast<uint32_t>(key.size()), static_cast<uint32_t>(value.size())};
+    std::memcpy(record.data(), lengths, kHeaderBytes);
+    std::memcpy(record.data() + kHeaderBytes, key.data(), key.size());
+    std::memcpy(record.data() + kHeaderBytes + key.size(), value.data(), value.size());
+    pwrite_all(m_active->fd, record.data(), record.size(), m_active->size);
+
+    Location location{m_active->id, static_cast<uint32_t>(value.size()), m_active->size + kHeaderBytes + key.size()};
+    m_active->size += record_bytes;
+    m_active->live_bytes += value.size();
+    m_active->written_bytes += value.size();
+    return location;
+}
+
+std::shared_ptr<ValueLog::Segment> ValueLog::compaction_candidate()
+{
+    std::shared_ptr<Segment> best;
+    double best_ratio = kCompactLiveRatio;
+    for (const auto &[id, segment] : m_segments)
+    {
+        if (!segment->sealed || segment->compacting || segment->written_bytes == 0)
+        {
+            continue;
+        }
+        double ratio = static_cast<double>(segment->live_bytes) / static_cast<double>(segment->written_bytes);
+        if (ratio < best_ratio)
+        {
+            best = segment;
+            best_ratio = ratio;
+        }
+    }
+    return best;
+}
+
+void ValueLog::schedule_compaction()
+{
+    if (!compaction_candidate())
+    {
+        return;
+    }
+    if (!m_thread.joinable())
+    {
+        m_thread = std::thread(&ValueLog::run, this);
+    }
+    m_work_cv.notify_one();
+}
+
+void ValueLog::compact(const std::shared_ptr<Segment> &segment, uint64_t generation)
+{
+    // Sealed segments never change, so the file is read without the lock.
+    std::string data(segment->size, '\0');
+    pread_all(segment->fd, data.data(), data.size(), 0);
+
+    size_t pos = 0;
+    while (pos + kHeaderBytes <= data.size())
+    {
+        uint32_t lengths[2];
+        std::memcpy(lengths, data.data() + pos, kHeaderBytes);
+        std::string_view key(data.data() + pos + kHeaderBytes, lengths[0]);
+        std::string_view value(key.data() + key.size(), lengths[1]);
+        Location from{segment->id, lengths[1], pos + kHeaderBytes + lengths[0]};
+        pos += kHeaderBytes + lengths[0] + lengths[1];
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (generation != m_generation)
+        {
+            return;
+        }
+        if (segment->dead.count(from.offset) == 0)
+        {
+            Location to = append_locked(key, value);
+            m_relocations.push_back(Relocation{std::string(key), from, to});
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (generation == m_generation)
+    {
+        m_compacted.push_back(segment->id);
+        m_compactions++;
+    }
+}
+
+void ValueLog::run()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        m_work_cv.wait(lock, [this]
+                       { return m_stop || compaction_candidate(); });
+        if (m_stop)
+        {
+            return;
+        }
+
+        auto segment = compaction_candidate();
+        segment->compacting = true;
+        m_busy = true;
+        uint64_t generation = m_generation;
+        lock.unlock();
+
+        try
+        {
+            compact(segment, generation);
+        }
+        catch (const std::exception &)
+        {
+            // Leave the segment as it is; its records stay readable.
+        }
+
+        lock.lock();
+        m_busy = false;
+        if (!compaction_candidate())
+        {
+            m_idle_cv.notify_all();
+        }
+    }
+}
@@ -3,6 +3,7 @@
 #include <atomic>
 #include <thread>
 #include <chrono>
+#include <cstring>
 
 #include "Server.hpp"
 
@@ -20,12 +21,60 @@ void signal_handler(int signal)
 int main(int argc, char *argv[])
 {
     int port = 6379; // default redis port?
+    int io_threads = 0;
+    DataStore::TieringOptions tiering;
+    size_t compress_threshold = 0;
 
-    if (argc > 1)
+    // usage: redis-lite [port] [--io-threads N] [--tiered-dir DIR [--tiered-cold-seconds N]]
+    //                   [--compress-threshold BYTES]
+    for (int i = 1; i < argc; i++)
     {
+        if (std::strcmp(argv[i], "--compress-threshold") == 0 && i + 1 < argc)
+        {
+            try
+            {
+                compress_threshold = std::stoul(argv[++i]);
+            }
+            catch (const std::exception &e)
+            {
+                std::cerr << "Invalid compression threshold provided. Compression stays off" << std::endl;
+            }
+            continue;
+        }
+        if (std::strcmp(argv[i], "--tiered-dir") == 0 && i + 1 < argc)
+        {
+            tiering.directory = argv[++i];
+            continue;
+        }
+        if (std::strcmp(argv[i], "--tiered-cold-seconds") == 0 && i + 1 < argc)
+        {
+            try
+            {
+                tiering.cold_after = std::chrono::seconds(std::stoi(argv[++i]));
+            }
+            catch (const std::exception &e)
+            {
+                std::cerr << "Invalid cold threshold provided. Using " << tiering.cold_after.count() << " seconds" << std::endl;
+            }
+            continue;
+        }
+        if (std::strcmp(argv[i], "--io-threads") == 0 && i + 1 < argc)
+        {
+            try
+            {
+                io_threads = std::stoi(argv[++i]);
+            }
+            catch (const std::exception &e)
+            {
+                std::cerr << "Invalid I/O thread count provided. Serving connections from the event loop" << std::endl;
+                io_threads = 0;
+            }
+            continue;
+        }
+
         try
         {
-            port = std::stoi(argv[1]);
+            port = std::stoi(argv[i]);
         }
         catch (const std::exception &e)
         {
@@ -34,12 +83,27 @@ int main(int argc, char *argv[])
         }
     }
 
+    if (io_threads > 0)
+    {
+        std::cout << "Using " << io_threads << " I/O threads, commands run on one thread" << std::endl;
+    }
+    else
+    {
+        io_threads = 0;
+        std::cout << "Serving connections as coroutines on one event loop thread" << std::endl;
+    }
+
     std::signal(SIGINT, signal_handler);
     std::signal(SIGTERM, signal_handler);
 
     try
     {
-        Server server(port);
+        Server server(port, io_threads);
+        if (!tiering.directory.empty())
+        {
+            server.enable_tiering(tiering);
+        }
+        server.set_compression_threshold(compress_threshold);
         std::thread server_thread([&server]()
                                   { server.start(); });
 
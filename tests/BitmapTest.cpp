@@ -0,0 +1,123 @@
+#include <cstdint>
+#include <random>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "../include/Bitmap.hpp"
+#include "../include/CpuFeatures.hpp"
+
+namespace
+{
+    std::vector<uint8_t> random_bytes(size_t size, uint32_t seed)
+    {
+        std::mt19937 rng(seed);
+        std::vector<uint8_t> bytes(size);
+        for (auto &byte : bytes)
+        {
+            byte = static_cast<uint8_t>(rng());
+        }
+        return bytes;
+    }
+
+    uint64_t naive_count(const std::vector<uint8_t> &bytes)
+    {
+        uint64_t total = 0;
+        for (uint8_t byte : bytes)
+        {
+            for (int bit = 0; bit < 8; bit++)
+            {
+                total += (byte >> bit) & 1;
+            }
+        }
+        return total;
+    }
+}
+
+TEST(BitmapTest, CountKernelsAgree)
+{
+    // sizes straddling the 8- and 32-byte strides and the AVX2 fold interval
+    for (size_t size : {0, 1, 7, 8, 31, 32, 33, 100, 992, 993, 4096, 100003})
+    {
+        auto bytes = random_bytes(size, static_cast<uint32_t>(size));
+        uint64_t expected = naive_count(bytes);
+        EXPECT_EQ(bitmap::count_scalar(bytes.data(), size), expected) << size;
+        if (cpu::has_avx2())
+        {
+            EXPECT_EQ(bitmap::count_avx2(bytes.data(), size), expected) << size;
+        }
+        EXPECT_EQ(bitmap::count(bytes.data(), size), expected) << size;
+    }
+
+    std::vector<uint8_t> ones(1000, 0xff);
+    EXPECT_EQ(bitmap::count(ones.data(), ones.size()), 8000);
+}
+
+TEST(BitmapTest, FindUsesMostSignificantBitFirst)
+{
+    std::vector<uint8_t> bytes(100, 0);
+    EXPECT_EQ(bitmap::find(bytes.data(), bytes.size(), true), -1);
+    EXPECT_EQ(bitmap::find(bytes.data(), bytes.size(), false), 0);
+
+    for (size_t byte : {0, 5, 31, 32, 63, 99})
+    {
+        for (int bit = 0; bit < 8; bit++)
+        {
+            std::vector<uint8_t> zeros(100, 0);
+            zeros[byte] = static_cast<uint8_t>(0x80 >> bit);
+            std::vector<uint8_t> ones(100, 0xff);
+            ones[byte] = static_cast<uint8_t>(~(0x80 >> bit));
+            int64_t expected = static_cast<int64_t>(byte * 8) + bit;
+            EXPECT_EQ(bitmap::find_scalar(zeros.data(), zeros.size(), true), expected);
+            EXPECT_EQ(bitmap::find_scalar(ones.data(), ones.size(), false), expected);
+            EXPECT_EQ(bitmap::find(zeros.data(), zeros.size(), true), expected);
+            if (cpu::has_avx2())
+            {
+                EXPECT_EQ(bitmap::find_avx2(zeros.data(), zeros.size(), true), expected);
+                EXPECT_EQ(bitmap::find_avx2(ones.data(), ones.size(), false), expected);
+            }
+        }
+    }
+}
+
+TEST(BitmapTest, CombineKernelsAgree)
+{
+    for (size_t size : {0, 3, 8, 31, 32, 65, 1000})
+    {
+        auto a = random_bytes(size, 1);
+        auto b = random_bytes(size, 2);
+        for (auto op : {bitmap::Op::And, bitmap::Op::Or, bitmap::Op::Xor})
+        {
+            std::vector<uint8_t> expected(size);
+            for (size_t i = 0; i < size; i++)
+            {
+                expected[i] = op == bitmap::Op::And  ? a[i] & b[i]
+                              : op == bitmap::Op::Or ? a[i] | b[i]
+                                                     : a[i] ^ b[i];
+            }
+            auto scalar = a;
+            bitmap::combine_scalar(op, scalar.data(), b.data(), size);
+            EXPECT_EQ(scalar, expected);
+            if (cpu::has_avx2())
+            {
+                auto avx2 = a;
+                bitmap::combine_avx2(op, avx2.data(), b.data(), size);
+                EXPECT_EQ(avx2, expected);
+            }
+        }
+
+        std::vector<uint8_t> inverted(size);
+        for (size_t i = 0; i < size; i++)
+        {
+            inverted[i] = static_cast<uint8_t>(~a[i]);
+        }
+        auto scalar = a;
+        bitmap::invert_scalar(scalar.data(), size);
+        EXPECT_EQ(scalar, inverted);
+        if (cpu::has_avx2())
+        {
+            auto avx2 = a;
+            bitmap::invert_avx2(avx2.data(), size);
+            EXPECT_EQ(avx2, inverted);
+        }
+    }
+}
@@ -0,0 +1,53 @@
+#include <memory>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <gtest/gtest.h>
+
+#include "../include/Client.hpp"
+
+TEST(ClientTest, PushedMessagesAreQueuedUntilReleased)
+{
+    int sockets[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sockets), 0);
+    {
+        Client client(1, sockets[0], 64);
+        auto message = std::make_shared<const std::string>(32, 'm');
+        client.deliver(message);
+
+        auto &pushed = client.take_pushed();
+        ASSERT_EQ(pushed.size(), 1);
+        EXPECT_EQ(pushed.front().get(), message.get());
+        pushed.clear();
+
+        // Still charged against the limit until released.
+        client.deliver(message);
+        EXPECT_FALSE(client.dropped());
+        client.release_pushed(32);
+        client.deliver(message);
+        EXPECT_FALSE(client.dropped());
+    }
+    close(sockets[0]);
+    close(sockets[1]);
+}
+
+TEST(ClientTest, SlowSubscriberIsDropped)
+{
+    int sockets[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sockets), 0);
+    {
+        Client client(1, sockets[0], 64);
+        auto message = std::make_shared<const std::string>(40, 'm');
+        client.deliver(message);
+        EXPECT_FALSE(client.dropped());
+        client.deliver(message);
+        EXPECT_TRUE(client.dropped());
+        EXPECT_TRUE(client.take_pushed().empty());
+
+        // The peer sees the connection shut down.
+        char byte;
+        EXPECT_EQ(recv(sockets[1], &byte, 1, 0), 0);
+    }
+    close(sockets[0]);
+    close(sockets[1]);
+}
@@ -0,0 +1,85 @@
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <gtest/gtest.h>
+
+#include "../include/Compression.hpp"
+
+namespace
+{
+    std::string json_records(int count)
+    {
+        std::string out = "[";
+        for (int i = 0; i < count; i++)
+        {
+            out += R"({"id":)" + std::to_string(i) + R"(,"name":"user)" + std::to_string(i * 7919 % 1000) +
+                   R"(","active":true,"roles":["reader","writer"],"score":)" + std::to_string(i * 31 % 97) + "},";
+        }
+        out += "]";
+        return out;
+    }
+
+    std::string random_string(size_t size)
+    {
+        std::mt19937 rng(42);
+        std::string out(size, '\0');
+        for (auto &c : out)
+        {
+            c = static_cast<char>(rng());
+        }
+        return out;
+    }
+}
+
+TEST(CompressionTest, RoundTripsRepetitiveData)
+{
+    std::string input = json_records(1000);
+    auto block = compression::compress(input);
+    ASSERT_TRUE(block.has_value());
+    EXPECT_EQ(block->codec, compression::Codec::LZ);
+    EXPECT_EQ(block->size, input.size());
+    EXPECT_LT(block->data.size(), input.size() / 3);
+    EXPECT_EQ(compression::decompress(*block), input);
+}
+
+TEST(CompressionTest, RoundTripsEdgeCases)
+{
+    // short inputs, long runs (overlapping matches), long literal runs
+    for (const std::string &input : {std::string(), std::string("a"), std::string("abcdefghijklm"),
+                                      std::string(100000, 'x'), std::string("ab") + std::string(1000, 'b'),
+                                      random_string(1000), random_string(300) + random_string(300)})
+    {
+        std::string data = compression::lz_compress(input);
+        EXPECT_EQ(compression::lz_decompress(data, input.size()), input) << input.size();
+    }
+}
+
+TEST(CompressionTest, SkipsIncompressibleData)
+{
+    EXPECT_FALSE(compression::compress(random_string(4096)).has_value());
+}
+
+TEST(CompressionTest, RejectsCorruptBlocks)
+{
+    std::string input = json_records(100);
+    std::string data = compression::lz_compress(input);
+    EXPECT_THROW(compression::lz_decompress(data, input.size() + 1), std::runtime_error);
+    EXPECT_THROW(compression::lz_decompress(data.substr(0, data.size() / 2), input.size()), std::runtime_error);
+    EXPECT_THROW(compression::lz_decompress("", 0), std::runtime_error);
+    // a match reaching back before the start of the output
+    EXPECT_THROW(compression::lz_decompress(std::string("\x10" "a" "\x05\x00", 4), 5), std::runtime_error);
+    // a size no block of this length expands to is rejected before allocating
+    EXPECT_THROW(compression::lz_decompress(data, size_t{1} << 60), std::runtime_error);
+
+    auto block = compression::compress(input);
+    ASSERT_TRUE(block.has_value());
+    EXPECT_TRUE(compression::is_valid(*block));
+    EXPECT_FALSE(compression::is_valid(compression::Block{static_cast<compression::Codec>(9), block->size, block->data}));
+    EXPECT_FALSE(compression::is_valid(compression::Block{block->codec, block->size * 1000, block->data}));
+
+    // highly repetitive input stays within the expansion bound
+    std::string run(1 << 20, 'a');
+    auto packed = compression::compress(run);
+    ASSERT_TRUE(packed.has_value());
+    EXPECT_EQ(compression::decompress(*packed), run);
+}
@@ -1,5 +1,10 @@
+#include <atomic>
 #include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
 #include <thread>
+#include <vector>
 #include <gtest/gtest.h>
 #include "../include/DataStore.hpp"
 
@@ -81,6 +86,271 @@ TEST(DataStoreTest, ListOperations)
     EXPECT_EQ(value, expected_list);
 }
 
+TEST(DataStoreTest, LPOP_RPOP)
+{
+    DataStore data_store;
+    data_store.rpush("mylist", "one");
+    data_store.rpush("mylist", "two");
+    data_store.rpush("mylist", "three");
+
+    EXPECT_EQ(data_store.lpop("mylist"), "one");
+    EXPECT_EQ(data_store.rpop("mylist"), "three");
+    EXPECT_EQ(data_store.lpop("mylist"), "two");
+    // the emptied list is gone
+    EXPECT_FALSE(data_store.exists("mylist"));
+    EXPECT_EQ(data_store.lpop("mylist"), std::nullopt);
+
+    data_store.set("string", "value");
+    EXPECT_EQ(data_store.rpop("string"), std::nullopt);
+}
+
+TEST(DataStoreTest, PFADD_PFCOUNT_PFMERGE)
+{
+    DataStore data_store;
+    EXPECT_TRUE(data_store.pfadd("hll1", {"a", "b", "c"}));
+    EXPECT_FALSE(data_store.pfadd("hll1", {"a"}));
+    EXPECT_TRUE(data_store.pfadd("hll2", {"c", "d"}));
+    EXPECT_TRUE(data_store.pfadd("empty", {}));
+
+    EXPECT_EQ(data_store.pfcount({"hll1"}), 3);
+    EXPECT_EQ(data_store.pfcount({"hll1", "hll2", "missing"}), 4);
+    EXPECT_EQ(data_store.pfcount({"missing"}), 0);
+
+    data_store.pfmerge("merged", {"hll1", "hll2"});
+    EXPECT_EQ(data_store.pfcount({"merged"}), 4);
+
+    data_store.set("string", "value");
+    EXPECT_THROW(data_store.pfadd("string", {"a"}), std::runtime_error);
+    EXPECT_THROW(data_store.pfcount({"hll1", "string"}), std::runtime_error);
+    EXPECT_THROW(data_store.pfmerge("merged", {"string"}), std::runtime_error);
+    EXPECT_EQ(data_store.pfcount({"merged"}), 4);
+}
+
+TEST(DataStoreTest, SETBIT_GETBIT)
+{
+    DataStore data_store;
+    EXPECT_EQ(data_store.setbit("bits", 7, true), 0);
+    EXPECT_EQ(data_store.get("bits"), std::string("\x01", 1));
+    EXPECT_EQ(data_store.setbit("bits", 7, true), 1);
+    EXPECT_EQ(data_store.setbit("bits", 100, true), 0);
+    EXPECT_EQ(data_store.get("bits").size(), 13);
+    EXPECT_EQ(data_store.getbit("bits", 100), 1);
+    EXPECT_EQ(data_store.getbit("bits", 99), 0);
+    EXPECT_EQ(data_store.getbit("bits", 1000), 0);
+    EXPECT_EQ(data_store.getbit("missing", 0), 0);
+
+    // bitmaps are plain strings
+    data_store.set("string", "a"); // 0110 0001
+    EXPECT_EQ(data_store.getbit("string", 1), 1);
+    EXPECT_EQ(data_store.setbit("string", 6, true), 0);
+    EXPECT_EQ(data_store.get("string"), "c");
+
+    data_store.lpush("list", "a");
+    EXPECT_THROW(data_store.setbit("list", 0, true), std::runtime_error);
+    EXPECT_THROW(data_store.getbit("list", 0), std::runtime_error);
+}
+
+TEST(DataStoreTest, BITCOUNT_BITPOS)
+{
+    DataStore data_store;
+    data_store.set("key", "foobar");
+    EXPECT_EQ(data_store.bitcount("key", {}), 26);
+    EXPECT_EQ(data_store.bitcount("key", {0, 0, false}), 4);
+    EXPECT_EQ(data_store.bitcount("key", {1, 1, false}), 6);
+    EXPECT_EQ(data_store.bitcount("key", {-2, -1, false}), 7);
+    EXPECT_EQ(data_store.bitcount("key", {5, 30, true}), 17);
+    EXPECT_EQ(data_store.bitcount("key", {3, 1, false}), 0);
+    EXPECT_EQ(data_store.bitcount("missing", {}), 0);
+
+    data_store.set("bits", std::string("\xff\xf0\x00", 3));
+    EXPECT_EQ(data_store.bitpos("bits", false, {}), 12);
+    EXPECT_EQ(data_store.bitpos("bits", true, {2, std::nullopt, false}), -1);
+    EXPECT_EQ(data_store.bitpos("bits", true, {0, -1, false}), 0);
+    EXPECT_EQ(data_store.bitpos("bits", true, {3, 15, true}), 3);
+    EXPECT_EQ(data_store.bitpos("bits", false, {7, 11, true}), -1);
+
+    data_store.set("ones", std::string("\xff\xff", 2));
+    EXPECT_EQ(data_store.bitpos("ones", false, {}), 16);
+    EXPECT_EQ(data_store.bitpos("ones", false, {0, -1, false}), -1);
+    EXPECT_EQ(data_store.bitpos("missing", true, {}), -1);
+    EXPECT_EQ(data_store.bitpos("missing", false, {}), 0);
+}
+
+TEST(DataStoreTest, BITOP)
+{
+    DataStore data_store;
+    data_store.set("a", "abcd");
+    data_store.set("b", "ab");
+
+    EXPECT_EQ(data_store.bitop(DataStore::BitOp::And, "dest", {"a", "b"}), 4);
+    EXPECT_EQ(data_store.get("dest"), std::string("ab\0\0", 4));
+    EXPECT_EQ(data_store.bitop(DataStore::BitOp::Or, "dest", {"a", "b", "missing"}), 4);
+    EXPECT_EQ(data_store.get("dest"), "abcd");
+    EXPECT_EQ(data_store.bitop(DataStore::BitOp::Xor, "dest", {"a", "b"}), 4);
+    EXPECT_EQ(data_store.get("dest"), std::string("\0\0cd", 4));
+    EXPECT_EQ(data_store.bitop(DataStore::BitOp::Not, "dest", {"b"}), 2);
+    EXPECT_EQ(data_store.get("dest"), std::string("\x9e\x9d", 2));
+
+    // an empty result deletes the destination
+    EXPECT_EQ(data_store.bitop(DataStore::BitOp::Or, "dest", {"missing"}), 0);
+    EXPECT_FALSE(data_store.exists("dest"));
+
+    data_store.lpush("list", "a");
+    EXPECT_THROW(data_store.bitop(DataStore::BitOp::And, "dest", {"a", "list"}), std::runtime_error);
+    EXPECT_FALSE(data_store.exists("dest"));
+}
+
+TEST(DataStoreTest, CompressesLargeStrings)
+{
+    DataStore data_store;
+    data_store.set_compression_threshold(1024);
+    std::string json;
+    for (int i = 0; i < 200; i++)
+    {
+        json += R"({"user":)" + std::to_string(i) + R"(,"flags":["beta","dark-mode"]},)";
+    }
+    data_store.set("json", json);
+    data_store.set("small", "{}");
+
+    auto stats = data_store.compression_stats();
+    EXPECT_EQ(stats.threshold, 1024);
+    EXPECT_EQ(stats.compressed, 1);
+    EXPECT_EQ(stats.input_bytes, json.size());
+    EXPECT_LT(stats.output_bytes, json.size() / 2);
+
+    EXPECT_EQ(data_store.get("json"), json);
+    EXPECT_EQ(data_store.get("small"), "{}");
+    EXPECT_EQ(data_store.compression_stats().decompressed, 1);
+
+    // reading commands decompress a copy and leave the value compressed...
+    EXPECT_EQ(data_store.bitcount("json", {}), data_store.bitcount("json", {0, -1, false}));
+    EXPECT_EQ(data_store.getbit("json", 1), 1);
+    EXPECT_EQ(data_store.compression_stats().decompressed, 4);
+    EXPECT_EQ(data_store.get("json"), json);
+    EXPECT_EQ(data_store.compression_stats().decompressed, 5);
+
+    // ...modifying commands work on the decompressed string
+    EXPECT_EQ(data_store.setbit("json", 0, true), 0);
+    EXPECT_EQ(data_store.compression_stats().decompressed, 6);
+    json[0] = static_cast<char>(json[0] | 0x80);
+    EXPECT_EQ(data_store.get("json"), json);
+    EXPECT_EQ(data_store.compression_stats().decompressed, 6);
+
+    const std::string filename = "compressed.rdb";
+    data_store.set("json", json);
+    ASSERT_TRUE(data_store.save(filename));
+    DataStore restored;
+    ASSERT_TRUE(restored.load(filename));
+    EXPECT_EQ(restored.get("json"), json);
+    EXPECT_EQ(restored.get("small"), "{}");
+    std::remove(filename.c_str());
+}
+
+TEST(DataStoreTest, SnapshotsCompressLargeStringsOnLoad)
+{
+    const std::string filename = "uncompressed.rdb";
+    std::string json;
+    for (int i = 0; i < 200; i++)
+    {
+        json += R"({"user":)" + std::to_string(i) + "},";
+    }
+    DataStore data_store;
+    data_store.set("json", json);
+    data_store.set_compression_threshold(1024);
+    ASSERT_TRUE(data_store.save(filename));
+    // saving leaves both the value and the statistics alone
+    EXPECT_EQ(data_store.compression_stats().compressed, 0);
+
+    DataStore restored;
+    restored.set_compression_threshold(1024);
+    ASSERT_TRUE(restored.load(filename));
+    EXPECT_EQ(restored.compression_stats().compressed, 1);
+    EXPECT_EQ(restored.get("json"), json);
+    EXPECT_EQ(restored.compression_stats().decompressed, 1);
+    std::remove(filename.c_str());
+}
+
+TEST(DataStoreTest, LoadRejectsCorruptCompressedValues)
+{
+    const std::string filename = "corrupt_compressed.rdb";
+    std::string json;
+    for (int i = 0; i < 200; i++)
+    {
+        json += R"({"user":)" + std::to_string(i) + "},";
+    }
+    // count, key length and key "k", then the type byte
+    constexpr size_t kCodecOffset = 2 * sizeof(size_t) + 1 + 1;
+    auto load_with = [&](const std::string &key_type, size_t offset, const std::string &bytes)
+    {
+        DataStore data_store;
+        data_store.set_compression_threshold(1024);
+        if (key_type == "string")
+        {
+            data_store.set("k", json);
+        }
+        else
+        {
+            data_store.rpush("k", json);
+        }
+        EXPECT_TRUE(data_store.save(filename));
+        {
+            std::fstream file(filename, std::ios::in | std::ios::out | std::ios::binary);
+            file.seekp(static_cast<std::streamoff>(offset));
+            file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        }
+        DataStore restored;
+        bool loaded = restored.load(filename);
+        std::remove(filename.c_str());
+        return loaded;
+    };
+
+    EXPECT_TRUE(load_with("string", kCodecOffset, std::string(1, '\1')));
+    EXPECT_FALSE(load_with("string", kCodecOffset, std::string(1, '\7'))); // unknown codec
+    EXPECT_FALSE(load_with("string", kCodecOffset + 1 + 7, std::string(1, '\x40'))); // size of 2^62
+    // a list element's codec follows the element count
+    EXPECT_TRUE(load_with("list", kCodecOffset + sizeof(size_t), std::string(1, '\1')));
+    EXPECT_FALSE(load_with("list", kCodecOffset + sizeof(size_t), std::string(1, '\7')));
+}
+
+TEST(DataStoreTest, CompressesLargeListElements)
+{
+    DataStore data_store;
+    data_store.set_compression_threshold(1024);
+    std::string json;
+    for (int i = 0; i < 200; i++)
+    {
+        json += R"({"event":)" + std::to_string(i) + R"(,"tags":["a","b"]},)";
+    }
+    data_store.rpush("events", json);
+    data_store.rpush("events", "small");
+    data_store.lpush("events", json + "]");
+    EXPECT_EQ(data_store.compression_stats().compressed, 2);
+
+    auto expected = std::vector<std::string>{json + "]", json, "small"};
+    EXPECT_EQ(data_store.lrange("events", 0, -1), expected);
+
+    const std::string filename = "compressed_list.rdb";
+    ASSERT_TRUE(data_store.save(filename));
+    DataStore restored;
+    ASSERT_TRUE(restored.load(filename));
+    std::remove(filename.c_str());
+    EXPECT_EQ(restored.lrange("events", 0, -1), expected);
+
+    DataStore::TieringOptions options;
+    options.directory = (std::filesystem::temp_directory_path() / "redis-lite-tiering-test").string();
+    options.cold_after = std::chrono::seconds(0);
+    options.min_value_bytes = 1;
+    data_store.enable_tiering(options);
+    data_store.run_tiering();
+    EXPECT_EQ(data_store.tiering_stats().spilled_keys, 1);
+    EXPECT_EQ(data_store.lrange("events", 0, -1), expected);
+
+    EXPECT_EQ(data_store.lpop("events"), json + "]");
+    EXPECT_EQ(data_store.rpop("events"), "small");
+    EXPECT_EQ(data_store.rpop("events"), json);
+    EXPECT_FALSE(data_store.exists("events"));
+}
+
 TEST(DataStoreTest, SaveAndLoad)
 {
     DataStore data_store;
@@ -97,3 +367,252 @@ TEST(DataStoreTest, SaveAndLoad)
     EXPECT_EQ(new_store.get("key1"), "value1");
     EXPECT_EQ(new_store.get("key2"), "value2");
 }
+
+TEST(DataStoreTest, UNLINK)
+{
+    DataStore data_store;
+    for (int i = 0; i < 1000; i++)
+    {
+        data_store.rpush("biglist", std::to_string(i));
+    }
+    data_store.set("key", "value");
+
+    EXPECT_TRUE(data_store.unlink("biglist"));
+    EXPECT_TRUE(data_store.unlink("key"));
+    EXPECT_FALSE(data_store.unlink("no-key"));
+    EXPECT_FALSE(data_store.exists("biglist"));
+    EXPECT_TRUE(data_store.lrange("biglist", 0, -1).empty());
+}
+
+TEST(DataStoreTest, DelAndOverwriteUseLazyFreeThreshold)
+{
+    DataStore data_store;
+    data_store.set_lazyfree_threshold(10);
+    for (int i = 0; i < 100; i++)
+    {
+        data_store.rpush("list", std::to_string(i));
+    }
+
+    // waits for the reclaimer to get through what was queued
+    auto freed_eventually = [&data_store](size_t expected)
+    {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (data_store.lazyfree_stats().freed_objects < expected && std::chrono::steady_clock::now() < deadline)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return data_store.lazyfree_stats().freed_objects;
+    };
+
+    // Overwriting the list with a string hands the list to the reclaimer.
+    data_store.set("list", "value");
+    EXPECT_EQ(data_store.get("list"), "value");
+    EXPECT_EQ(freed_eventually(1), 1);
+
+    // A string is below the threshold and freed inline.
+    EXPECT_TRUE(data_store.del("list"));
+    EXPECT_FALSE(data_store.exists("list"));
+    auto stats = data_store.lazyfree_stats();
+    EXPECT_EQ(stats.pending_objects, 0);
+    EXPECT_EQ(stats.freed_objects, 1);
+
+    for (int i = 0; i < 100; i++)
+    {
+        data_store.rpush("list", std::to_string(i));
+    }
+    data_store.rpush("short", "a");
+    data_store.rpush("short", "b");
+    EXPECT_TRUE(data_store.del("short"));
+    EXPECT_EQ(data_store.lazyfree_stats().pending_objects, 0);
+    EXPECT_EQ(data_store.lazyfree_stats().freed_objects, 1);
+    EXPECT_TRUE(data_store.del("list"));
+    EXPECT_EQ(freed_eventually(2), 2);
+    EXPECT_EQ(data_store.lazyfree_stats().pending_objects, 0);
+}
+
+TEST(DataStoreTest, FLUSHALL)
+{
+    DataStore data_store;
+    int flushes = 0;
+    data_store.set_flush_listener([&flushes]()
+                                  { flushes++; });
+
+    data_store.set("a", "1");
+    data_store.rpush("b", "x");
+    data_store.flushall(true);
+    EXPECT_FALSE(data_store.exists("a"));
+    EXPECT_FALSE(data_store.exists("b"));
+
+    data_store.set("c", "3");
+    data_store.flushall(false);
+    EXPECT_FALSE(data_store.exists("c"));
+    EXPECT_EQ(flushes, 2);
+}
+
+TEST(DataStoreTest, TieringSpillsColdValues)
+{
+    DataStore data_store;
+    DataStore::TieringOptions options;
+    options.directory = (std::filesystem::temp_directory_path() / "redis-lite-tiering-test").string();
+    options.cold_after = std::chrono::seconds(0); // everything is cold
+    options.min_value_bytes = 64;
+    data_store.enable_tiering(options);
+
+    std::string big(1000, 'v');
+    data_store.set("big", big);
+    data_store.set("small", "tiny");
+    for (int i = 0; i < 100; i++)
+    {
+        data_store.rpush("list", std::string(20, 'a' + i % 26));
+    }
+
+    data_store.run_tiering();
+    auto stats = data_store.tiering_stats();
+    EXPECT_EQ(stats.spilled_keys, 2); // "small" is below min_value_bytes
+    EXPECT_GT(stats.log.live_bytes, 1000);
+
+    // Reads bring values back transparently.
+    EXPECT_EQ(data_store.get("big"), big);
+    auto list = data_store.lrange("list", 0, 1);
+    EXPECT_EQ(list, (std::vector<std::string>{std::string(20, 'a'), std::string(20, 'b')}));
+    EXPECT_EQ(data_store.tiering_stats().spilled_keys, 0);
+    EXPECT_EQ(data_store.tiering_stats().log.live_bytes, 0);
+
+    // Overwriting or deleting a spilled value releases its record.
+    data_store.run_tiering();
+    EXPECT_EQ(data_store.tiering_stats().spilled_keys, 2);
+    data_store.set("big", "new");
+    EXPECT_TRUE(data_store.del("list"));
+    EXPECT_EQ(data_store.tiering_stats().spilled_keys, 0);
+    EXPECT_EQ(data_store.get("big"), "new");
+}
+
+TEST(DataStoreTest, TieringSpillsCompressedValues)
+{
+    DataStore data_store;
+    DataStore::TieringOptions options;
+    options.directory = (std::filesystem::temp_directory_path() / "redis-lite-tiering-test").string();
+    options.cold_after = std::chrono::seconds(0);
+    options.min_value_bytes = 1;
+    data_store.enable_tiering(options);
+    data_store.set_compression_threshold(64);
+
+    std::string big(1000, 'v');
+    data_store.set("big", big);
+    data_store.run_tiering();
+    EXPECT_EQ(data_store.tiering_stats().spilled_keys, 1);
+
+    // read back still compressed, and decompressed for the reply
+    EXPECT_EQ(data_store.get("big"), big);
+    EXPECT_EQ(data_store.tiering_stats().spilled_keys, 0);
+    EXPECT_EQ(data_store.compression_stats().decompressed, 1);
+}
+
+TEST(DataStoreTest, TieringKeepsSpilledValuesInSnapshots)
+{
+    const std::string filename = "tiering_snapshot.rdb";
+    {
+        DataStore data_store;
+        DataStore::TieringOptions options;
+        options.directory = (std::filesystem::temp_directory_path() / "redis-lite-tiering-test").string();
+        options.cold_after = std::chrono::seconds(0);
+        options.min_value_bytes = 1;
+        data_store.enable_tiering(options);
+        data_store.set("key", "spilled value");
+        data_store.run_tiering();
+        ASSERT_EQ(data_store.tiering_stats().spilled_keys, 1);
+        ASSERT_TRUE(data_store.save(filename));
+    }
+    DataStore restored;
+    ASSERT_TRUE(restored.load(filename));
+    EXPECT_EQ(restored.get("key"), "spilled value");
+    std::remove(filename.c_str());
+}
+
+TEST(DataStoreTest, LockFreeReadsFollowWrites)
+{
+    DataStore data_store;
+    data_store.set("key", "value");
+    EXPECT_EQ(data_store.get("key"), "value");
+    data_store.set("key", "other");
+    EXPECT_EQ(data_store.get("key"), "other");
+    EXPECT_EQ(data_store.incr("counter"), 1);
+    EXPECT_EQ(data_store.get("counter"), "1");
+
+    // modified in place, then served again
+    data_store.setbit("key", 39, true);
+    EXPECT_EQ(data_store.get("key"), "othes");
+    EXPECT_EQ(data_store.get("key"), "othes");
+
+    data_store.rpush("list", "x");
+    EXPECT_TRUE(data_store.exists("list"));
+    EXPECT_TRUE(data_store.del("key"));
+    EXPECT_FALSE(data_store.exists("key"));
+    EXPECT_EQ(data_store.get("key"), "");
+
+    data_store.set("short", "lived", std::chrono::milliseconds(1));
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    EXPECT_FALSE(data_store.exists("short"));
+    EXPECT_EQ(data_store.get("short"), "");
+}
+
+TEST(DataStoreTest, ConcurrentGetDuringWrites)
+{
+    DataStore data_store;
+    constexpr int kKeys = 32;
+    for (int i = 0; i < kKeys; i++)
+    {
+        data_store.set("key:" + std::to_string(i), std::string(16, 'a'));
+    }
+
+    std::atomic<bool> done{false};
+    std::atomic<int> torn{0};
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; r++)
+    {
+        readers.emplace_back([&]
+                             {
+                                 while (!done)
+                                 {
+                                     for (int i = 0; i < kKeys; i++)
+                                     {
+                                         std::string value = data_store.get("key:" + std::to_string(i));
+                                         if (!value.empty() && value.find_first_not_of(value[0]) != std::string::npos)
+                                         {
+                                             torn++;
+                                         }
+                                     }
+                                 } });
+    }
+    for (int round = 0; round < 5000; round++)
+    {
+        std::string key = "key:" + std::to_string(round % kKeys);
+        if (round % 5 == 0)
+        {
+            data_store.del(key);
+        }
+        data_store.set(key, std::string(16 + round % 64, static_cast<char>('a' + round % 26)));
+    }
+    done = true;
+    for (auto &reader : readers)
+    {
+        reader.join();
+    }
+    EXPECT_EQ(torn.load(), 0);
+}
+
+TEST(DataStoreTest, SingleThreadedModeKeepsValues)
+{
+    DataStore data_store;
+    data_store.set("a", "1");
+    data_store.set_single_threaded(true);
+    EXPECT_EQ(data_store.get("a"), "1");
+    data_store.set("b", "2");
+    data_store.del("a");
+
+    data_store.set_single_threaded(false);
+    EXPECT_FALSE(data_store.exists("a"));
+    EXPECT_EQ(data_store.get("b"), "2");
+    data_store.set("b", "3");
+    EXPECT_EQ(data_store.get("b"), "3");
+}
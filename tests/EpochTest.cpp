@@ -0,0 +1,76 @@
+#include <atomic>
+#include <thread>
+#include <gtest/gtest.h>
+
+#include "../include/Epoch.hpp"
+
+namespace
+{
+    struct Tracked
+    {
+        std::atomic<bool> *freed;
+        ~Tracked() { freed->store(true); }
+    };
+
+    // Enough rounds for the epoch to move past anything retired before.
+    void collect_all()
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            epoch::collect();
+        }
+    }
+}
+
+TEST(EpochTest, FreesRetiredObjectsWithoutGuards)
+{
+    std::atomic<bool> freed{false};
+    epoch::retire(new Tracked{&freed});
+    collect_all();
+    EXPECT_TRUE(freed.load());
+}
+
+TEST(EpochTest, GuardDefersReclamation)
+{
+    std::atomic<bool> freed{false};
+    std::atomic<bool> pinned{false};
+    std::atomic<bool> release{false};
+    std::thread reader([&]
+                       {
+                           epoch::Guard guard;
+                           pinned = true;
+                           while (!release)
+                           {
+                               std::this_thread::yield();
+                           } });
+    while (!pinned)
+    {
+        std::this_thread::yield();
+    }
+
+    epoch::retire(new Tracked{&freed});
+    collect_all();
+    EXPECT_FALSE(freed.load());
+
+    release = true;
+    reader.join();
+    collect_all();
+    EXPECT_TRUE(freed.load());
+}
+
+TEST(EpochTest, NestedGuardsPinUntilTheOutermostEnds)
+{
+    std::atomic<bool> freed{false};
+    {
+        epoch::Guard outer;
+        {
+            epoch::Guard inner;
+        }
+        epoch::retire(new Tracked{&freed});
+        collect_all();
+        EXPECT_FALSE(freed.load());
+    }
+    collect_all();
+    EXPECT_TRUE(freed.load());
+    EXPECT_EQ(epoch::pending(), 0);
+}
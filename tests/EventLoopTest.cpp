@@ -0,0 +1,184 @@
+#include <chrono>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <gtest/gtest.h>
+
+#include "../include/EventLoop.hpp"
+
+namespace
+{
+    Task read_line(EventLoop &loop, int fd, std::string &out, bool &done)
+    {
+        char buffer[64];
+        while (true)
+        {
+            ssize_t n = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+            if (n > 0)
+            {
+                out.append(buffer, n);
+                if (out.back() == '\n')
+                {
+                    break;
+                }
+            }
+            else if (n == 0)
+            {
+                break;
+            }
+            else
+            {
+                co_await loop.readable(fd);
+            }
+        }
+        done = true;
+    }
+
+    Task sleep_then(EventLoop &loop, std::chrono::milliseconds duration, int &step)
+    {
+        step = 1;
+        co_await loop.sleep_for(duration);
+        step = 2;
+    }
+
+    Task wait_readable(EventLoop &loop, int fd, int &resumes)
+    {
+        co_await loop.readable(fd);
+        resumes++;
+    }
+}
+
+TEST(EventLoopTest, ResumesOnReadable)
+{
+    int sockets[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sockets), 0);
+    EventLoop loop;
+    loop.watch(sockets[0]);
+
+    std::string line;
+    bool done = false;
+    read_line(loop, sockets[0], line, done);
+    EXPECT_FALSE(done); // suspended: nothing to read yet
+
+    ASSERT_EQ(write(sockets[1], "hel", 3), 3);
+    loop.run_once(std::chrono::milliseconds(100));
+    EXPECT_FALSE(done);
+    EXPECT_EQ(line, "hel");
+
+    ASSERT_EQ(write(sockets[1], "lo\n", 3), 3);
+    loop.run_once(std::chrono::milliseconds(100));
+    EXPECT_TRUE(done);
+    EXPECT_EQ(line, "hello\n");
+
+    loop.unwatch(sockets[0]);
+    close(sockets[0]);
+    close(sockets[1]);
+}
+
+TEST(EventLoopTest, TimersResumeInOrder)
+{
+    EventLoop loop;
+    int first = 0;
+    int second = 0;
+    sleep_then(loop, std::chrono::milliseconds(20), second);
+    sleep_then(loop, std::chrono::milliseconds(1), first);
+
+    auto deadline = EventLoop::Clock::now() + std::chrono::seconds(2);
+    while (first != 2 && EventLoop::Clock::now() < deadline)
+    {
+        loop.run_once(std::chrono::milliseconds(100));
+    }
+    EXPECT_EQ(first, 2);
+    EXPECT_EQ(second, 1);
+
+    while (second != 2 && EventLoop::Clock::now() < deadline)
+    {
+        loop.run_once(std::chrono::milliseconds(100));
+    }
+    EXPECT_EQ(second, 2);
+}
+
+TEST(EventLoopTest, CancelledTimerDoesNotFire)
+{
+    EventLoop loop;
+    bool fired = false;
+    auto timer = loop.add_timer(EventLoop::Clock::now(), [&]
+                                { fired = true; });
+    loop.cancel_timer(timer);
+    loop.run_once(std::chrono::milliseconds(0));
+    EXPECT_FALSE(fired);
+}
+
+TEST(EventLoopTest, WakeResumesWaiter)
+{
+    int sockets[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sockets), 0);
+    EventLoop loop;
+    loop.watch(sockets[0]);
+    // drain the initial writability edge
+    loop.run_once(std::chrono::milliseconds(0));
+
+    int resumes = 0;
+    wait_readable(loop, sockets[0], resumes);
+    loop.run_once(std::chrono::milliseconds(0));
+    EXPECT_EQ(resumes, 0);
+
+    loop.wake(sockets[0]);
+    loop.run_once(std::chrono::milliseconds(0));
+    EXPECT_EQ(resumes, 1);
+
+    loop.unwatch(sockets[0]);
+    close(sockets[0]);
+    close(sockets[1]);
+}
+
+TEST(EventLoopTest, WritableCallbackFiresOnceSocketDrains)
+{
+    int sockets[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sockets), 0);
+    EventLoop loop;
+    loop.watch(sockets[0]);
+    loop.run_once(std::chrono::milliseconds(0));
+
+    // writable already: called right away
+    int calls = 0;
+    loop.on_writable(sockets[0], [&calls]
+                     { calls++; });
+    EXPECT_EQ(calls, 1);
+
+    char buffer[4096] = {};
+    while (send(sockets[0], buffer, sizeof(buffer), 0) > 0)
+    {
+    }
+    loop.on_writable(sockets[0], [&calls]
+                     { calls++; });
+    loop.run_once(std::chrono::milliseconds(0));
+    EXPECT_EQ(calls, 1);
+
+    while (recv(sockets[1], buffer, sizeof(buffer), 0) > 0)
+    {
+    }
+    loop.run_once(std::chrono::milliseconds(100));
+    EXPECT_EQ(calls, 2);
+
+    loop.unwatch(sockets[0]);
+    close(sockets[0]);
+    close(sockets[1]);
+}
+
+TEST(EventLoopTest, FramesAreRecycled)
+{
+    EventLoop loop;
+    int step = 0;
+    sleep_then(loop, std::chrono::milliseconds(0), step);
+    size_t cached = FramePool::cached_frames();
+    loop.run_once(std::chrono::milliseconds(100));
+    ASSERT_EQ(step, 2);
+    // the finished coroutine's frame went back to the pool...
+    EXPECT_EQ(FramePool::cached_frames(), cached + 1);
+
+    // ...and the next one of the same shape reuses it
+    sleep_then(loop, std::chrono::milliseconds(0), step);
+    EXPECT_EQ(FramePool::cached_frames(), cached);
+    loop.run_once(std::chrono::milliseconds(100));
+}
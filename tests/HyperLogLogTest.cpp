@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "../include/CpuFeatures.hpp"
+#include "../include/HyperLogLog.hpp"
+
+namespace
+{
+    double relative_error(uint64_t estimate, uint64_t actual)
+    {
+        return std::abs(static_cast<double>(estimate) - static_cast<double>(actual)) / static_cast<double>(actual);
+    }
+}
+
+TEST(HyperLogLogTest, EmptyCountsZero)
+{
+    HyperLogLog hll;
+    EXPECT_EQ(hll.count(), 0);
+    EXPECT_TRUE(hll.is_sparse());
+}
+
+TEST(HyperLogLogTest, SmallCardinalitiesAreNearlyExact)
+{
+    HyperLogLog hll;
+    for (int i = 0; i < 100; i++)
+    {
+        hll.add("element:" + std::to_string(i));
+    }
+    EXPECT_TRUE(hll.is_sparse());
+    EXPECT_NEAR(static_cast<double>(hll.count()), 100.0, 2.0);
+
+    // duplicates change nothing
+    EXPECT_FALSE(hll.add("element:7"));
+}
+
+TEST(HyperLogLogTest, PromotesToDense)
+{
+    HyperLogLog hll;
+    for (int i = 0; i < 5000; i++)
+    {
+        hll.add("element:" + std::to_string(i));
+    }
+    EXPECT_FALSE(hll.is_sparse());
+    EXPECT_EQ(hll.bytes(), HyperLogLog::kDenseBytes);
+    EXPECT_LE(hll.bytes(), 12 * 1024 + 1);
+    EXPECT_LT(relative_error(hll.count(), 5000), 0.03);
+}
+
+TEST(HyperLogLogTest, LargeCardinalityWithinErrorBound)
+{
+    HyperLogLog hll;
+    const uint64_t n = 1000000;
+    for (uint64_t i = 0; i < n; i++)
+    {
+        hll.add(std::to_string(i));
+    }
+    // 0.81% standard error; 3 sigma
+    EXPECT_LT(relative_error(hll.count(), n), 0.025);
+}
+
+TEST(HyperLogLogTest, MergeIsUnion)
+{
+    HyperLogLog a;
+    HyperLogLog b;
+    HyperLogLog both;
+    for (int i = 0; i < 20000; i++)
+    {
+        std::string element = std::to_string(i);
+        (i % 2 ? a : b).add(element);
+        both.add(element);
+    }
+    a.merge(b);
+    EXPECT_EQ(a.count(), both.count());
+
+    // sparse with sparse stays sparse
+    HyperLogLog c;
+    HyperLogLog d;
+    c.add("x");
+    d.add("y");
+    c.merge(d);
+    EXPECT_TRUE(c.is_sparse());
+    EXPECT_EQ(c.count(), 2);
+}
+
+TEST(HyperLogLogTest, SerializeRoundTrip)
+{
+    HyperLogLog sparse;
+    sparse.add("a");
+    sparse.add("b");
+    HyperLogLog dense;
+    for (int i = 0; i < 5000; i++)
+    {
+        dense.add(std::to_string(i));
+    }
+
+    EXPECT_EQ(HyperLogLog::deserialize(sparse.serialize()).count(), sparse.count());
+    EXPECT_EQ(HyperLogLog::deserialize(dense.serialize()).count(), dense.count());
+    EXPECT_THROW(HyperLogLog::deserialize("garbage"), std::runtime_error);
+
+    // a dense register can hold 63, more than a 64-bit hash ever yields
+    std::string corrupt = dense.serialize();
+    corrupt[1] = static_cast<char>(corrupt[1] | 0x3f);
+    EXPECT_THROW(HyperLogLog::deserialize(corrupt), std::runtime_error);
+}
+
+TEST(HyperLogLogTest, MaxKernelsAgree)
+{
+    std::vector<uint8_t> a(HyperLogLog::kRegisters + 7);
+    std::vector<uint8_t> b(a.size());
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        a[i] = static_cast<uint8_t>((i * 7) % 52);
+        b[i] = static_cast<uint8_t>((i * 13) % 52);
+    }
+    std::vector<uint8_t> expected(a.size());
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        expected[i] = std::max(a[i], b[i]);
+    }
+    auto scalar = a;
+    HyperLogLog::max_registers_scalar(scalar.data(), b.data(), a.size());
+    EXPECT_EQ(scalar, expected);
+    if (cpu::has_avx2())
+    {
+        auto avx2 = a;
+        HyperLogLog::max_registers_avx2(avx2.data(), b.data(), a.size());
+        EXPECT_EQ(avx2, expected);
+    }
+}
@@ -0,0 +1,79 @@
+#include <atomic>
+#include <set>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "../include/IOThreadPool.hpp"
+
+TEST(IOThreadPoolTest, RunsEveryIndexOnce)
+{
+    IOThreadPool pool(4);
+    std::vector<std::atomic<int>> calls(1000);
+
+    pool.run(calls.size(), [&](size_t i)
+             { calls[i]++; });
+
+    for (const auto &count : calls)
+    {
+        EXPECT_EQ(count.load(), 1);
+    }
+}
+
+TEST(IOThreadPoolTest, SpreadsWorkAcrossThreads)
+{
+    IOThreadPool pool(3);
+    EXPECT_EQ(pool.size(), 3);
+
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+    pool.run(3, [&](size_t)
+             {
+                 std::lock_guard<std::mutex> lock(mutex);
+                 threads.insert(std::this_thread::get_id());
+             });
+
+    // strided shares: each of the three threads gets exactly one index
+    EXPECT_EQ(threads.size(), 3);
+}
+
+TEST(IOThreadPoolTest, SmallBatchesRunInline)
+{
+    IOThreadPool pool(4);
+    std::thread::id runner;
+
+    pool.run(1, [&](size_t)
+             { runner = std::this_thread::get_id(); });
+
+    EXPECT_EQ(runner, std::this_thread::get_id());
+}
+
+TEST(IOThreadPoolTest, ReusableAcrossBatches)
+{
+    IOThreadPool pool(2);
+    std::atomic<size_t> total{0};
+
+    for (size_t batch = 0; batch < 100; batch++)
+    {
+        pool.run(batch, [&](size_t i)
+                 { total += i + 1; });
+    }
+
+    size_t expected = 0;
+    for (size_t batch = 0; batch < 100; batch++)
+    {
+        expected += batch * (batch + 1) / 2;
+    }
+    EXPECT_EQ(total.load(), expected);
+}
+
+TEST(IOThreadPoolTest, SingleThreadPoolHasNoWorkers)
+{
+    IOThreadPool pool(1);
+    EXPECT_EQ(pool.size(), 1);
+
+    std::atomic<int> calls{0};
+    pool.run(10, [&](size_t)
+             { calls++; });
+    EXPECT_EQ(calls.load(), 10);
+}
@@ -0,0 +1,101 @@
+#include <string>
+#include <gtest/gtest.h>
+
+#include "../include/DataStore.hpp"
+#include "../include/KeyStats.hpp"
+
+TEST(KeyStatsTest, HotKeysSurfaceFromSampledAccesses)
+{
+    KeyStats stats(0, 4); // count every access
+    for (int i = 0; i < 1000; i++)
+    {
+        stats.record_access("hot");
+        if (i % 10 == 0)
+        {
+            stats.record_access("warm");
+        }
+        stats.record_access("cold:" + std::to_string(i));
+    }
+
+    auto hot = stats.hot_keys(2);
+    ASSERT_EQ(hot.size(), 2);
+    EXPECT_EQ(hot[0].key, "hot");
+    EXPECT_GE(hot[0].accesses, 1000);
+    EXPECT_EQ(hot[1].key, "warm");
+}
+
+TEST(KeyStatsTest, SampledCountsAreScaled)
+{
+    KeyStats stats(3, 4);
+    for (int i = 0; i < 8000; i++)
+    {
+        stats.record_access("key");
+    }
+    auto hot = stats.hot_keys(1);
+    ASSERT_EQ(hot.size(), 1);
+    EXPECT_EQ(hot[0].accesses, 8000);
+}
+
+TEST(KeyStatsTest, BigKeysPerType)
+{
+    KeyStats stats(3, 2);
+    stats.record_size("small", "string", 10);
+    stats.record_size("medium", "string", 100);
+    stats.record_size("large", "string", 1000);
+    stats.record_size("list", "list", 5);
+
+    auto big = stats.big_keys(10);
+    ASSERT_EQ(big.size(), 3);
+    EXPECT_EQ(big[0].key, "list");
+    EXPECT_EQ(big[1].key, "large");
+    EXPECT_EQ(big[2].key, "medium");
+
+    stats.record_removal("large");
+    stats.record_size("medium", "list", 50); // type changed
+    big = stats.big_keys(10);
+    ASSERT_EQ(big.size(), 2);
+    EXPECT_EQ(big[0].key, "medium");
+    EXPECT_EQ(big[0].size, 50);
+}
+
+TEST(KeyStatsTest, BigKeysFollowShrinkingSizes)
+{
+    KeyStats stats(3, 2);
+    stats.record_size("a", "string", 100);
+    stats.record_size("b", "string", 1000);
+    stats.record_size("b", "string", 10); // now the smallest held
+    stats.record_size("c", "string", 50);
+
+    auto big = stats.big_keys(10);
+    ASSERT_EQ(big.size(), 2);
+    EXPECT_EQ(big[0].key, "a");
+    EXPECT_EQ(big[1].key, "c");
+
+    // removing frees a slot for any size, then the table is full again
+    stats.record_removal("a");
+    stats.record_size("d", "string", 5);
+    stats.record_size("e", "string", 20);
+    big = stats.big_keys(10);
+    ASSERT_EQ(big.size(), 2);
+    EXPECT_EQ(big[0].key, "c");
+    EXPECT_EQ(big[1].key, "e");
+}
+
+TEST(KeyStatsTest, DataStoreTracksSizes)
+{
+    DataStore store;
+    store.set("str", std::string(500, 'x'));
+    for (int i = 0; i < 20; i++)
+    {
+        store.rpush("list", "x");
+    }
+    store.set("gone", std::string(10000, 'x'));
+    store.del("gone");
+
+    auto big = store.big_keys(1);
+    ASSERT_EQ(big.size(), 2);
+    EXPECT_EQ(big[0].key, "list");
+    EXPECT_EQ(big[0].size, 20);
+    EXPECT_EQ(big[1].key, "str");
+    EXPECT_EQ(big[1].size, 500);
+}
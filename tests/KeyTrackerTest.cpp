@@ -0,0 +1,182 @@
+#include <memory>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "../include/DataStore.hpp"
+#include "../include/KeyTracker.hpp"
+
+namespace
+{
+    class RecordingSubscriber : public Subscriber
+    {
+    public:
+        explicit RecordingSubscriber(int protocol = 3) : m_protocol(protocol) {}
+
+        int protocol() const override { return m_protocol; }
+        void deliver(std::shared_ptr<const std::string> message) override { messages.push_back(*message); }
+
+        std::vector<std::string> messages;
+
+    private:
+        int m_protocol;
+    };
+}
+
+TEST(KeyTrackerTest, InvalidatesKeysReadByClient)
+{
+    PubSub pubsub;
+    KeyTracker tracker(pubsub);
+    RecordingSubscriber client;
+    tracker.enable(1, client, client, {});
+
+    tracker.remember(1, "user:1");
+    tracker.invalidate("user:2");
+    EXPECT_TRUE(client.messages.empty());
+
+    tracker.invalidate("user:1");
+    ASSERT_EQ(client.messages.size(), 1);
+    EXPECT_EQ(client.messages[0], ">2\r\n$10\r\ninvalidate\r\n*1\r\n$6\r\nuser:1\r\n");
+
+    // One invalidation per read: the key is forgotten until read again.
+    tracker.invalidate("user:1");
+    EXPECT_EQ(client.messages.size(), 1);
+    EXPECT_EQ(tracker.tracked_keys(), 0);
+}
+
+TEST(KeyTrackerTest, RedirectToResp2Subscriber)
+{
+    PubSub pubsub;
+    KeyTracker tracker(pubsub);
+    RecordingSubscriber client(2);
+    RecordingSubscriber redirect_target(2);
+    tracker.enable(1, client, redirect_target, {});
+
+    // nothing is sent until the target subscribes to the channel
+    tracker.remember(1, "k");
+    tracker.invalidate("k");
+    EXPECT_TRUE(redirect_target.messages.empty());
+
+    pubsub.subscribe(redirect_target, KeyTracker::kInvalidateChannel);
+    tracker.remember(1, "k");
+    tracker.invalidate("k");
+    ASSERT_EQ(redirect_target.messages.size(), 1);
+    EXPECT_EQ(redirect_target.messages[0],
+              "*3\r\n$7\r\nmessage\r\n$20\r\n__redis__:invalidate\r\n*1\r\n$1\r\nk\r\n");
+
+    tracker.remember(1, "k");
+    tracker.forget(2, redirect_target);
+    tracker.invalidate("k");
+    EXPECT_EQ(redirect_target.messages.size(), 1);
+    EXPECT_TRUE(client.messages.empty()); // RESP2 has no push to report it with
+    EXPECT_EQ(tracker.tracked_keys(), 0);
+}
+
+TEST(KeyTrackerTest, BrokenRedirectIsReported)
+{
+    PubSub pubsub;
+    KeyTracker tracker(pubsub);
+    RecordingSubscriber client;
+    RecordingSubscriber redirect_target;
+    tracker.enable(1, client, redirect_target, {});
+
+    tracker.forget(2, redirect_target);
+    ASSERT_EQ(client.messages.size(), 1);
+    EXPECT_EQ(client.messages[0], ">2\r\n$21\r\ntracking-redir-broken\r\n:2\r\n");
+
+    // tracking is off: reads are no longer remembered
+    tracker.remember(1, "k");
+    EXPECT_EQ(tracker.tracked_keys(), 0);
+}
+
+TEST(KeyTrackerTest, BroadcastPrefixes)
+{
+    PubSub pubsub;
+    KeyTracker tracker(pubsub);
+    RecordingSubscriber client;
+    KeyTracker::Options options;
+    options.broadcast = true;
+    options.prefixes = {"user:"};
+    tracker.enable(1, client, client, options);
+
+    tracker.invalidate("user:7");
+    tracker.invalidate("order:7");
+    tracker.invalidate("user:8");
+    ASSERT_EQ(client.messages.size(), 2);
+    EXPECT_EQ(tracker.tracked_keys(), 0);
+}
+
+TEST(KeyTrackerTest, TableIsBounded)
+{
+    PubSub pubsub;
+    KeyTracker tracker(pubsub, 2);
+    RecordingSubscriber client;
+    tracker.enable(1, client, client, {});
+
+    tracker.remember(1, "a");
+    tracker.remember(1, "b");
+    tracker.remember(1, "c");
+    EXPECT_EQ(tracker.tracked_keys(), 2);
+    // The evicted key was invalidated so the client cannot keep a stale copy.
+    EXPECT_EQ(client.messages.size(), 1);
+}
+
+TEST(KeyTrackerTest, EvictionLeavesBroadcastClientsAlone)
+{
+    PubSub pubsub;
+    KeyTracker tracker(pubsub, 2);
+    RecordingSubscriber client;
+    RecordingSubscriber broadcast;
+    KeyTracker::Options options;
+    options.broadcast = true;
+    tracker.enable(1, client, client, {});
+    tracker.enable(2, broadcast, broadcast, options);
+
+    for (const char *key : {"a", "b", "c", "d"})
+    {
+        tracker.remember(1, key);
+    }
+    // two keys evicted unwritten: only their reader hears of it
+    EXPECT_EQ(client.messages.size(), 2);
+    EXPECT_TRUE(broadcast.messages.empty());
+
+    tracker.invalidate("d"); // the last key read is never the one evicted
+    EXPECT_EQ(client.messages.size(), 3);
+    EXPECT_EQ(broadcast.messages.size(), 1);
+}
+
+TEST(KeyTrackerTest, InvalidateAll)
+{
+    PubSub pubsub;
+    KeyTracker tracker(pubsub);
+    RecordingSubscriber client;
+    tracker.enable(1, client, client, {});
+    tracker.remember(1, "a");
+
+    tracker.invalidate_all();
+    ASSERT_EQ(client.messages.size(), 1);
+    EXPECT_EQ(client.messages[0], ">2\r\n$10\r\ninvalidate\r\n_\r\n");
+    EXPECT_EQ(tracker.tracked_keys(), 0);
+}
+
+TEST(KeyTrackerTest, DataStoreWritesInvalidate)
+{
+    PubSub pubsub;
+    KeyTracker tracker(pubsub);
+    RecordingSubscriber client;
+    tracker.enable(1, client, client, {});
+
+    DataStore store;
+    store.set_key_listener([&tracker](const std::string &key)
+                           { tracker.invalidate(key); });
+
+    for (const char *key : {"s", "c", "l", "d"})
+    {
+        tracker.remember(1, key);
+    }
+    store.set("s", "v");
+    store.incr("c");
+    store.lpush("l", "x");
+    store.del("d"); // missing key: nothing written, nothing sent
+    EXPECT_EQ(client.messages.size(), 3);
+}
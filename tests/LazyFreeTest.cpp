@@ -0,0 +1,50 @@
+#include <list>
+#include <memory>
+#include <string>
+#include <gtest/gtest.h>
+
+#include "../include/LazyFree.hpp"
+
+namespace
+{
+    struct DestructionFlag
+    {
+        explicit DestructionFlag(std::shared_ptr<bool> flag) : flag(std::move(flag)) {}
+        DestructionFlag(DestructionFlag &&other) = default;
+        ~DestructionFlag()
+        {
+            if (flag)
+            {
+                *flag = true;
+            }
+        }
+        std::shared_ptr<bool> flag;
+    };
+}
+
+TEST(LazyFreeTest, FreesInBackground)
+{
+    LazyFree lazy_free;
+    auto destroyed = std::make_shared<bool>(false);
+
+    lazy_free.free_later(DestructionFlag(destroyed), 128);
+    lazy_free.wait_idle();
+
+    EXPECT_TRUE(*destroyed);
+    auto stats = lazy_free.stats();
+    EXPECT_EQ(stats.pending_objects, 0);
+    EXPECT_EQ(stats.pending_bytes, 0);
+    EXPECT_EQ(stats.freed_objects, 1);
+}
+
+TEST(LazyFreeTest, DrainsQueueOnDestruction)
+{
+    auto destroyed = std::make_shared<bool>(false);
+    {
+        LazyFree lazy_free;
+        std::list<std::string> big(100000, "element");
+        lazy_free.free_later(std::move(big), 100000 * 64);
+        lazy_free.free_later(DestructionFlag(destroyed), 0);
+    }
+    EXPECT_TRUE(*destroyed);
+}
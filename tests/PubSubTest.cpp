@@ -0,0 +1,101 @@
+#include <memory>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "../include/PubSub.hpp"
+
+namespace
+{
+    class RecordingSubscriber : public Subscriber
+    {
+    public:
+        explicit RecordingSubscriber(int protocol = 2) : m_protocol(protocol) {}
+
+        int protocol() const override { return m_protocol; }
+        void deliver(std::shared_ptr<const std::string> message) override { messages.push_back(std::move(message)); }
+
+        std::vector<std::shared_ptr<const std::string>> messages;
+
+    private:
+        int m_protocol;
+    };
+}
+
+TEST(PubSubTest, PublishToChannelSubscribers)
+{
+    PubSub pubsub;
+    RecordingSubscriber a, b;
+
+    EXPECT_EQ(pubsub.subscribe(a, "news"), 1);
+    EXPECT_EQ(pubsub.subscribe(a, "sports"), 2);
+    EXPECT_EQ(pubsub.subscribe(b, "news"), 1);
+
+    EXPECT_EQ(pubsub.publish("news", "hello"), 2);
+    EXPECT_EQ(pubsub.publish("weather", "rain"), 0);
+
+    ASSERT_EQ(a.messages.size(), 1);
+    ASSERT_EQ(b.messages.size(), 1);
+    EXPECT_EQ(*a.messages[0], "*3\r\n$7\r\nmessage\r\n$4\r\nnews\r\n$5\r\nhello\r\n");
+    // Encoded once and shared, not copied per subscriber.
+    EXPECT_EQ(a.messages[0].get(), b.messages[0].get());
+}
+
+TEST(PubSubTest, Resp3SubscribersReceivePushes)
+{
+    PubSub pubsub;
+    RecordingSubscriber resp2(2), resp3(3);
+    pubsub.subscribe(resp2, "ch");
+    pubsub.subscribe(resp3, "ch");
+
+    pubsub.publish("ch", "m");
+    EXPECT_EQ(*resp2.messages[0], "*3\r\n$7\r\nmessage\r\n$2\r\nch\r\n$1\r\nm\r\n");
+    EXPECT_EQ(*resp3.messages[0], ">3\r\n$7\r\nmessage\r\n$2\r\nch\r\n$1\r\nm\r\n");
+}
+
+TEST(PubSubTest, PatternSubscriptions)
+{
+    PubSub pubsub;
+    RecordingSubscriber a;
+    EXPECT_EQ(pubsub.psubscribe(a, "news.*"), 1);
+
+    EXPECT_EQ(pubsub.publish("news.tech", "x"), 1);
+    EXPECT_EQ(pubsub.publish("sports", "y"), 0);
+    ASSERT_EQ(a.messages.size(), 1);
+    EXPECT_EQ(*a.messages[0], "*4\r\n$8\r\npmessage\r\n$6\r\nnews.*\r\n$9\r\nnews.tech\r\n$1\r\nx\r\n");
+}
+
+TEST(PubSubTest, Unsubscribe)
+{
+    PubSub pubsub;
+    RecordingSubscriber a;
+    pubsub.subscribe(a, "one");
+    pubsub.subscribe(a, "two");
+    pubsub.psubscribe(a, "t*");
+
+    EXPECT_EQ(pubsub.unsubscribe(a, "one"), 2);
+    EXPECT_EQ(pubsub.unsubscribe(a, "missing"), 2);
+    EXPECT_EQ(pubsub.publish("one", "x"), 0);
+    EXPECT_EQ(pubsub.publish("two", "x"), 2); // channel and pattern
+
+    pubsub.unsubscribe_all(a);
+    EXPECT_EQ(pubsub.subscription_count(a), 0);
+    EXPECT_EQ(pubsub.publish("two", "x"), 0);
+}
+
+TEST(PubSubTest, PatternMatching)
+{
+    EXPECT_TRUE(PubSub::pattern_matches("*", "anything"));
+    EXPECT_TRUE(PubSub::pattern_matches("h?llo", "hello"));
+    EXPECT_FALSE(PubSub::pattern_matches("h?llo", "hllo"));
+    EXPECT_TRUE(PubSub::pattern_matches("h*llo", "heeeello"));
+    EXPECT_TRUE(PubSub::pattern_matches("h[ae]llo", "hallo"));
+    EXPECT_FALSE(PubSub::pattern_matches("h[ae]llo", "hillo"));
+    EXPECT_TRUE(PubSub::pattern_matches("h[^e]llo", "hallo"));
+    EXPECT_FALSE(PubSub::pattern_matches("h[^e]llo", "hello"));
+    EXPECT_TRUE(PubSub::pattern_matches("h[a-c]llo", "hbllo"));
+    EXPECT_TRUE(PubSub::pattern_matches("h\\*llo", "h*llo"));
+    EXPECT_FALSE(PubSub::pattern_matches("h\\*llo", "hello"));
+    EXPECT_TRUE(PubSub::pattern_matches("a*b*c", "axxbyyc"));
+    EXPECT_FALSE(PubSub::pattern_matches("a*b*c", "axxbyy"));
+}
@@ -33,3 +33,82 @@ TEST(RESPParserTest, ParseCommandWithArguments)
     EXPECT_FALSE(parser.has_next());
     EXPECT_EQ(parser.get_remaining_data(), "");
 }
+
+TEST(RESPParserTest, ParsePipelinedCommands)
+{
+    std::string data = "*3\r\n$3\r\nSET\r\n$3\r\nkey\r\n$5\r\nvalue\r\n*2\r\n$3\r\nGET\r\n$3\r\nkey\r\n";
+    RESPParser parser(data);
+
+    auto command = parser.next_command();
+    std::vector<std::string> expected = {"SET", "key", "value"};
+    EXPECT_EQ(command, expected);
+
+    command = parser.next_command();
+    expected = {"GET", "key"};
+    EXPECT_EQ(command, expected);
+
+    EXPECT_FALSE(parser.has_next());
+}
+
+TEST(RESPParserTest, BulkStringMayContainCRLF)
+{
+    std::string data = "*2\r\n$4\r\nECHO\r\n$6\r\na\r\nb\r\n\r\n*1\r\n$4\r\nPING\r\n";
+    RESPParser parser(data);
+
+    auto command = parser.next_command();
+    EXPECT_EQ(command[1], "a\r\nb\r\n");
+    command = parser.next_command();
+    EXPECT_EQ(command[0], "PING");
+}
+
+TEST(RESPParserTest, IncompleteCommandIsLeftUnconsumed)
+{
+    std::string complete = "*1\r\n$4\r\nPING\r\n";
+    std::string partial = "*2\r\n$4\r\nECHO\r\n$5\r\nHel";
+    std::string data = complete + partial;
+    RESPParser parser(data);
+
+    std::vector<std::string_view> args;
+    EXPECT_TRUE(parser.try_next_command(args));
+    EXPECT_EQ(args.size(), 1);
+    EXPECT_FALSE(parser.try_next_command(args));
+    EXPECT_FALSE(parser.has_next());
+    EXPECT_EQ(parser.consumed(), complete.size());
+    EXPECT_EQ(parser.get_remaining_data(), partial);
+}
+
+TEST(RESPParserTest, IncompleteLengthLine)
+{
+    std::string data = "*2\r\n$4";
+    RESPParser parser(data);
+
+    std::vector<std::string_view> args;
+    EXPECT_FALSE(parser.try_next_command(args));
+    EXPECT_EQ(parser.consumed(), 0);
+}
+
+TEST(RESPParserTest, ParseInlineCommand)
+{
+    std::string data = "SET  key value\r\nPING\n";
+    RESPParser parser(data);
+
+    auto command = parser.next_command();
+    std::vector<std::string> expected = {"SET", "key", "value"};
+    EXPECT_EQ(command, expected);
+
+    command = parser.next_command();
+    expected = {"PING"};
+    EXPECT_EQ(command, expected);
+    EXPECT_FALSE(parser.has_next());
+}
+
+TEST(RESPParserTest, RejectsMalformedLength)
+{
+    std::string data = "*1\r\n$x4\r\nPING\r\n";
+    RESPParser parser(data);
+    EXPECT_THROW(parser.next_command(), std::runtime_error);
+
+    std::string negative = "*-1\r\n";
+    RESPParser negative_parser(negative);
+    EXPECT_THROW(negative_parser.next_command(), std::runtime_error);
+}
@@ -0,0 +1,87 @@
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "../include/CpuFeatures.hpp"
+#include "../include/RESPScanner.hpp"
+
+namespace
+{
+    std::vector<size_t> naive_crlf(const std::string &data)
+    {
+        std::vector<size_t> result;
+        for (size_t i = 0; i + 1 < data.size(); i++)
+        {
+            if (data[i] == '\r' && data[i + 1] == '\n')
+            {
+                result.push_back(i);
+            }
+        }
+        return result;
+    }
+}
+
+TEST(RESPScannerTest, KernelsAgreeWithNaiveScan)
+{
+    // Place delimiters on and around every 16/32 byte boundary.
+    std::string data(200, 'x');
+    for (size_t i : {0, 14, 15, 16, 31, 32, 63, 64, 95, 127, 150, 198})
+    {
+        data[i] = '\r';
+        data[i + 1] = '\n';
+    }
+    data[100] = '\r'; // lone CR
+    data[120] = '\n'; // lone LF
+    auto expected = naive_crlf(data);
+
+    std::vector<size_t> scalar, sse2, avx2, dispatched;
+    resp::find_crlf_scalar(data.data(), data.size(), 0, data.size(), scalar);
+    resp::find_crlf(data.data(), data.size(), 0, data.size(), dispatched);
+    EXPECT_EQ(scalar, expected);
+    EXPECT_EQ(dispatched, expected);
+
+    if (cpu::has_sse2())
+    {
+        resp::find_crlf_sse2(data.data(), data.size(), 0, data.size(), sse2);
+        EXPECT_EQ(sse2, expected);
+    }
+    if (cpu::has_avx2())
+    {
+        resp::find_crlf_avx2(data.data(), data.size(), 0, data.size(), avx2);
+        EXPECT_EQ(avx2, expected);
+    }
+}
+
+TEST(RESPScannerTest, RangeBoundaries)
+{
+    std::string data = "ab\r\ncd\r\nef\r\n";
+    std::vector<size_t> found;
+
+    // A CR on the last position of the range still matches the LF after it.
+    resp::find_crlf(data.data(), data.size(), 0, 7, found);
+    EXPECT_EQ(found, std::vector<size_t>({2, 6}));
+
+    found.clear();
+    resp::find_crlf(data.data(), data.size(), 3, data.size(), found);
+    EXPECT_EQ(found, std::vector<size_t>({6, 10}));
+
+    // A trailing CR without its LF is not a delimiter yet.
+    std::string partial = "ab\r";
+    found.clear();
+    resp::find_crlf(partial.data(), partial.size(), 0, partial.size(), found);
+    EXPECT_TRUE(found.empty());
+}
+
+TEST(RESPScannerTest, ParseLength)
+{
+    std::string input = "12345";
+    int64_t value = 0;
+    EXPECT_TRUE(resp::parse_length(input.data(), input.data() + input.size(), 100000, value));
+    EXPECT_EQ(value, 12345);
+
+    EXPECT_FALSE(resp::parse_length(input.data(), input.data() + input.size(), 1000, value));
+    EXPECT_FALSE(resp::parse_length(input.data(), input.data(), 1000, value));
+
+    std::string bad = "12a";
+    EXPECT_FALSE(resp::parse_length(bad.data(), bad.data() + bad.size(), 1000, value));
+}
@@ -0,0 +1,89 @@
+#include <string>
+#include <gtest/gtest.h>
+
+#include "../include/RESPWriter.hpp"
+
+TEST(RESPWriterTest, SimpleTypes)
+{
+    std::string out;
+    RESPWriter writer(out);
+
+    writer.ok();
+    writer.simple_string("PONG");
+    writer.error("ERR syntax error");
+    EXPECT_EQ(out, "+OK\r\n+PONG\r\n-ERR syntax error\r\n");
+}
+
+TEST(RESPWriterTest, Integers)
+{
+    std::string out;
+    RESPWriter writer(out);
+
+    writer.integer(0);
+    writer.integer(42);
+    writer.integer(9999);
+    writer.integer(10000);
+    writer.integer(-7);
+    writer.integer(INT64_MIN);
+    EXPECT_EQ(out, ":0\r\n:42\r\n:9999\r\n:10000\r\n:-7\r\n:-9223372036854775808\r\n");
+}
+
+TEST(RESPWriterTest, BulkStringsAndArrays)
+{
+    std::string out;
+    RESPWriter writer(out);
+
+    writer.array_header(2);
+    writer.bulk_string("hello");
+    writer.bulk_string(std::string(40, 'x'));
+    writer.null();
+    writer.null_array();
+    EXPECT_EQ(out, "*2\r\n$5\r\nhello\r\n$40\r\n" + std::string(40, 'x') + "\r\n$-1\r\n*-1\r\n");
+
+    out.clear();
+    writer.bulk_string("");
+    writer.array_header(100);
+    EXPECT_EQ(out, "$0\r\n\r\n*100\r\n");
+}
+
+TEST(RESPWriterTest, Resp3Types)
+{
+    std::string out;
+    RESPWriter writer(out, 3);
+
+    writer.map_header(1);
+    writer.bulk_string("pi");
+    writer.double_value(3.5);
+    writer.boolean(true);
+    writer.null();
+    writer.push_header(2);
+    EXPECT_EQ(out, "%1\r\n$2\r\npi\r\n,3.5\r\n#t\r\n_\r\n>2\r\n");
+}
+
+TEST(RESPWriterTest, Resp3TypesDegradeInResp2)
+{
+    std::string out;
+    RESPWriter writer(out, 2);
+
+    writer.map_header(1);
+    writer.double_value(3.5);
+    writer.boolean(false);
+    writer.push_header(3);
+    EXPECT_EQ(out, "*2\r\n$3\r\n3.5\r\n:0\r\n*3\r\n");
+}
+
+TEST(RESPWriterTest, ReusedBufferDoesNotGrow)
+{
+    std::string out;
+    out.reserve(256);
+    const char *data = out.data();
+    for (int i = 0; i < 100; i++)
+    {
+        out.clear();
+        RESPWriter writer(out);
+        writer.array_header(2);
+        writer.bulk_string("value");
+        writer.integer(i * 1000);
+    }
+    EXPECT_EQ(out.data(), data);
+}
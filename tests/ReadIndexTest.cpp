@@ -0,0 +1,122 @@
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "../include/Epoch.hpp"
+#include "../include/ReadIndex.hpp"
+
+TEST(ReadIndexTest, InsertFindErase)
+{
+    ReadIndex index;
+    EXPECT_EQ(index.find("key"), nullptr);
+
+    index.insert("key", new std::string("value"), std::nullopt, 7);
+    const ReadIndex::Node *node = index.find("key");
+    ASSERT_NE(node, nullptr);
+    EXPECT_EQ(*node->value, "value");
+    EXPECT_EQ(node->last_access.load(), 7u);
+
+    index.insert("key", nullptr, std::nullopt, 0);
+    node = index.find("key");
+    ASSERT_NE(node, nullptr);
+    EXPECT_EQ(node->value, nullptr);
+
+    index.erase("key");
+    EXPECT_EQ(index.find("key"), nullptr);
+    EXPECT_EQ(index.size(), 0);
+}
+
+TEST(ReadIndexTest, ReplacingANodeKeepsItsValue)
+{
+    ReadIndex index;
+    auto *value = new std::string("value");
+    index.insert("key", value, std::nullopt, 0);
+    auto expiry = ReadIndex::Clock::now();
+    index.insert("key", value, expiry, 0);
+    epoch::collect();
+    epoch::collect();
+    epoch::collect();
+
+    const ReadIndex::Node *node = index.find("key");
+    ASSERT_NE(node, nullptr);
+    EXPECT_EQ(node->value, value);
+    EXPECT_EQ(*node->value, "value");
+    EXPECT_EQ(node->expiry, expiry);
+}
+
+TEST(ReadIndexTest, GrowsAndClears)
+{
+    ReadIndex index;
+    for (int i = 0; i < 10000; i++)
+    {
+        index.insert("key:" + std::to_string(i), new std::string(std::to_string(i)), std::nullopt, 0);
+    }
+    EXPECT_EQ(index.size(), 10000);
+    for (int i = 0; i < 10000; i++)
+    {
+        const ReadIndex::Node *node = index.find("key:" + std::to_string(i));
+        ASSERT_NE(node, nullptr);
+        EXPECT_EQ(*node->value, std::to_string(i));
+    }
+
+    index.clear();
+    EXPECT_EQ(index.size(), 0);
+    EXPECT_EQ(index.find("key:0"), nullptr);
+}
+
+TEST(ReadIndexTest, ReadersSeeWholeValuesDuringWrites)
+{
+    ReadIndex index;
+    constexpr int kKeys = 64;
+    for (int i = 0; i < kKeys; i++)
+    {
+        index.insert("key:" + std::to_string(i), new std::string(16, 'a'), std::nullopt, 0);
+    }
+
+    std::atomic<bool> done{false};
+    std::atomic<int> torn{0};
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; r++)
+    {
+        readers.emplace_back([&]
+                             {
+                                 while (!done)
+                                 {
+                                     for (int i = 0; i < kKeys; i++)
+                                     {
+                                         epoch::Guard guard;
+                                         const ReadIndex::Node *node = index.find("key:" + std::to_string(i));
+                                         if (!node)
+                                         {
+                                             continue; // erased for the moment
+                                         }
+                                         const std::string &value = *node->value;
+                                         if (value.find_first_not_of(value[0]) != std::string::npos)
+                                         {
+                                             torn++;
+                                         }
+                                     }
+                                 } });
+    }
+
+    // replace, erase and re-add keys; values are runs of a single letter
+    for (int round = 0; round < 2000; round++)
+    {
+        std::string key = "key:" + std::to_string(round % kKeys);
+        if (round % 7 == 0)
+        {
+            index.erase(key);
+        }
+        index.insert(key, new std::string(16 + round % 32, static_cast<char>('a' + round % 26)), std::nullopt, 0);
+        index.insert("extra:" + std::to_string(round), new std::string(8, 'x'), std::nullopt, 0);
+    }
+    done = true;
+    for (auto &reader : readers)
+    {
+        reader.join();
+    }
+    EXPECT_EQ(torn.load(), 0);
+    EXPECT_EQ(index.size(), kKeys + 2000);
+}
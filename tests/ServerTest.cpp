@@ -0,0 +1,136 @@
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <gtest/gtest.h>
+
+#include "../include/Server.hpp"
+
+namespace
+{
+    // A server on an ephemeral port, served by its own thread.
+    class RunningServer
+    {
+    public:
+        explicit RunningServer(int io_threads = 0) : m_server(0, io_threads), m_thread([this]
+                                                                                      { m_server.start(); })
+        {
+        }
+
+        ~RunningServer()
+        {
+            m_server.stop();
+            m_thread.join();
+        }
+
+        int port() const { return m_server.port(); }
+
+    private:
+        Server m_server;
+        std::thread m_thread;
+    };
+
+    int connect_to(int port)
+    {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(port));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0)
+        {
+            close(fd);
+            return -1;
+        }
+        timeval timeout{2, 0};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        return fd;
+    }
+
+    void send_command(int fd, const std::vector<std::string> &args)
+    {
+        std::string request = "*" + std::to_string(args.size()) + "\r\n";
+        for (const auto &arg : args)
+        {
+            request += "$" + std::to_string(arg.size()) + "\r\n" + arg + "\r\n";
+        }
+        ASSERT_EQ(send(fd, request.data(), request.size(), MSG_NOSIGNAL), static_cast<ssize_t>(request.size()));
+    }
+
+    // Reads until `expected` has arrived, the peer hangs up or two seconds
+    // pass; returns everything read.
+    std::string read_until(int fd, const std::string &expected)
+    {
+        std::string received;
+        char buffer[4096];
+        while (received.find(expected) == std::string::npos)
+        {
+            ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+            if (n <= 0)
+            {
+                break;
+            }
+            received.append(buffer, n);
+        }
+        return received;
+    }
+}
+
+TEST(ServerTest, PushesReachClientBlockedInBlpop)
+{
+    RunningServer server;
+    int blocked = connect_to(server.port());
+    int writer = connect_to(server.port());
+    ASSERT_GE(blocked, 0);
+    ASSERT_GE(writer, 0);
+
+    send_command(blocked, {"HELLO", "3"});
+    read_until(blocked, "proto");
+    send_command(blocked, {"CLIENT", "TRACKING", "ON"});
+    EXPECT_EQ(read_until(blocked, "+OK\r\n"), "+OK\r\n");
+    send_command(blocked, {"GET", "k"});
+    EXPECT_EQ(read_until(blocked, "_\r\n"), "_\r\n");
+    send_command(blocked, {"BLPOP", "list", "0"});
+
+    // the invalidation goes out while the pop is still waiting
+    send_command(writer, {"SET", "k", "v"});
+    EXPECT_EQ(read_until(writer, "+OK\r\n"), "+OK\r\n");
+    EXPECT_EQ(read_until(blocked, "k\r\n"), ">2\r\n$10\r\ninvalidate\r\n*1\r\n$1\r\nk\r\n");
+
+    send_command(writer, {"RPUSH", "list", "x"});
+    EXPECT_EQ(read_until(writer, ":1\r\n"), ":1\r\n");
+    EXPECT_EQ(read_until(blocked, "x\r\n"), "*2\r\n$4\r\nlist\r\n$1\r\nx\r\n");
+
+    close(blocked);
+    close(writer);
+}
+
+TEST(ServerTest, QuitClosesAfterReplying)
+{
+    for (int io_threads : {0, 2})
+    {
+        RunningServer server(io_threads);
+        int fd = connect_to(server.port());
+        ASSERT_GE(fd, 0);
+        // pipelined: the PING after QUIT is never run
+        send_command(fd, {"PING"});
+        send_command(fd, {"QUIT"});
+        send_command(fd, {"PING"});
+        // read to the hangup
+        EXPECT_EQ(read_until(fd, "never sent"), "+PONG\r\n+OK\r\n") << io_threads;
+        close(fd);
+
+        // also allowed on a subscribed RESP2 connection
+        fd = connect_to(server.port());
+        ASSERT_GE(fd, 0);
+        send_command(fd, {"SUBSCRIBE", "news"});
+        read_until(fd, ":1\r\n");
+        send_command(fd, {"QUIT"});
+        EXPECT_EQ(read_until(fd, "never sent"), "+OK\r\n") << io_threads;
+        close(fd);
+    }
+}
@@ -0,0 +1,81 @@
+#include <filesystem>
+#include <string>
+#include <gtest/gtest.h>
+
+#include "../include/ValueLog.hpp"
+
+namespace
+{
+    std::string test_directory()
+    {
+        return (std::filesystem::temp_directory_path() / "redis-lite-valuelog-test").string();
+    }
+}
+
+TEST(ValueLogTest, AppendAndRead)
+{
+    ValueLog log(test_directory());
+    auto first = log.append("k1", "hello");
+    auto second = log.append("k2", std::string(10000, 'x'));
+
+    EXPECT_EQ(log.read(first), "hello");
+    EXPECT_EQ(log.read(second), std::string(10000, 'x'));
+
+    auto stats = log.stats();
+    EXPECT_EQ(stats.segments, 1);
+    EXPECT_EQ(stats.live_bytes, 10005);
+
+    log.release(first);
+    log.release(first); // idempotent
+    EXPECT_EQ(log.stats().live_bytes, 10000);
+}
+
+TEST(ValueLogTest, RollsOverSegments)
+{
+    ValueLog log(test_directory(), 1024);
+    for (int i = 0; i < 10; i++)
+    {
+        log.append("key" + std::to_string(i), std::string(300, 'a' + i));
+    }
+    EXPECT_GT(log.stats().segments, 1);
+}
+
+TEST(ValueLogTest, CompactionRelocatesLiveRecords)
+{
+    ValueLog log(test_directory(), 1024);
+    std::vector<ValueLog::Location> locations;
+    for (int i = 0; i < 6; i++)
+    {
+        locations.push_back(log.append("key" + std::to_string(i), std::string(300, 'a' + i)));
+    }
+    ASSERT_EQ(locations[0].segment, locations[2].segment);
+    ASSERT_NE(locations[0].segment, locations[5].segment);
+
+    // two thirds of the first, sealed segment become garbage
+    log.release(locations[0]);
+    log.release(locations[1]);
+    log.wait_compacted();
+
+    auto relocations = log.take_relocations();
+    ASSERT_EQ(relocations.size(), 1);
+    EXPECT_EQ(relocations[0].key, "key2");
+    EXPECT_EQ(relocations[0].from, locations[2]);
+    EXPECT_EQ(log.read(relocations[0].to), std::string(300, 'c'));
+    EXPECT_EQ(log.stats().compactions, 1);
+
+    // the compacted segment is gone
+    EXPECT_THROW(log.read(locations[2]), std::runtime_error);
+    EXPECT_EQ(log.read(locations[5]), std::string(300, 'f'));
+}
+
+TEST(ValueLogTest, ClearDropsEverything)
+{
+    ValueLog log(test_directory());
+    auto location = log.append("key", "value");
+    log.clear();
+
+    EXPECT_THROW(log.read(location), std::runtime_error);
+    EXPECT_EQ(log.stats().segments, 0);
+    auto again = log.append("key", "value");
+    EXPECT_EQ(log.read(again), "value");
+}